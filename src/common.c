@@ -9,6 +9,7 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <sys/stat.h>
+#include <unistd.h>
 
 char *progname = NULL;
 int is_debug_enabled = 0;
@@ -128,3 +129,23 @@ mkpath(const char *path, mode_t mode, int is_dir)
 	return status;
 }
 
+/* Writes all the bytes of the buffer, retrying the short and interrupted
+ * writes. Returns 0 on success or -1 on error. */
+int
+write_all(int fd, const void *buf, size_t len)
+{
+	const char *p = buf;
+	while (len > 0) {
+		ssize_t n = write(fd, p, len);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			err("write failed:");
+			return -1;
+		}
+		p += n;
+		len -= (size_t) n;
+	}
+
+	return 0;
+}
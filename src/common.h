@@ -13,6 +13,7 @@ extern int is_debug_enabled;
 /* Path and file utilities */
 
 int mkpath(const char *path, mode_t mode, int is_dir);
+int write_all(int fd, const void *buf, size_t len);
 
 /* Debug macros */
 
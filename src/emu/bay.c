@@ -2,20 +2,95 @@
  * SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include "bay.h"
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include "chan.h"
 #include "common.h"
 #include "uthash.h"
-#include "utlist.h"
+
+static int
+push_id(long **arr, long *n, long *max, long id)
+{
+	if (*n >= *max) {
+		long newmax = *max == 0 ? 64 : *max * 2;
+		long *a = realloc(*arr, (size_t) newmax * sizeof(long));
+		if (a == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		*arr = a;
+		*max = newmax;
+	}
+
+	(*arr)[(*n)++] = id;
+
+	return 0;
+}
+
+static int
+push_task(struct bay_task ***arr, long *n, long *max, struct bay_task *task)
+{
+	if (*n >= *max) {
+		long newmax = *max == 0 ? 16 : *max * 2;
+		struct bay_task **a = realloc(*arr, (size_t) newmax * sizeof(struct bay_task *));
+		if (a == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		*arr = a;
+		*max = newmax;
+	}
+
+	(*arr)[(*n)++] = task;
+
+	return 0;
+}
+
+/* Places a dirty channel in the level it must be processed. The
+ * channels that are written from a level above their own (not declared
+ * as task outputs) are processed in the current level. */
+static int
+enqueue_chan(struct bay *bay, long id)
+{
+	int level = bay->channels[id].level;
+	if (level < bay->curlevel)
+		level = bay->curlevel;
+
+	struct bay_level *lvl = &bay->levels[level];
+	return push_id(&lvl->chans, &lvl->nchans, &lvl->maxchans, id);
+}
+
+static int
+enqueue_task(struct bay *bay, struct bay_task *task)
+{
+	int level = task->level;
+	if (level < bay->curlevel)
+		level = bay->curlevel;
+
+	struct bay_level *lvl = &bay->levels[level];
+	return push_task(&lvl->tasks, &lvl->ntasks, &lvl->maxtasks, task);
+}
+
+static struct bay_chan *
+get_bay_chan(struct bay *bay, struct chan *chan)
+{
+	long id = chan->id;
+	if (id < 0 || id >= bay->nchannels)
+		return NULL;
+
+	struct bay_chan *bchan = &bay->channels[id];
+	if (bchan->chan != chan)
+		return NULL;
+
+	return bchan;
+}
 
 /* Called from the channel when it becomes dirty */
 static int
 cb_chan_is_dirty(struct chan *chan, void *arg)
 {
-	UNUSED(chan);
-	struct bay_chan *bchan = arg;
-	struct bay *bay = bchan->bay;
+	struct bay *bay = arg;
 
 	if (bay->state != BAY_READY && bay->state != BAY_PROPAGATING) {
 		err("cannot add dirty channel %s in current bay state",
@@ -23,33 +98,39 @@ cb_chan_is_dirty(struct chan *chan, void *arg)
 		return -1;
 	}
 
+	struct bay_chan *bchan = &bay->channels[chan->id];
 	if (bchan->is_dirty) {
 		err("channel %s already on dirty list", chan->name);
 		return -1;
 	}
 
 	dbg("adding dirty chan %s", chan->name);
-	DL_APPEND(bay->dirty, bchan);
+	if (push_id(&bay->dirty, &bay->ndirty, &bay->maxdirty, chan->id) != 0)
+		return -1;
+
+	/* Otherwise it is placed in its level when the propagation begins */
+	if (bay->state == BAY_PROPAGATING)
+		return enqueue_chan(bay, chan->id);
 
 	return 0;
 }
 
-static struct bay_chan *
-find_bay_chan(struct bay *bay, const char *name)
+static struct bay_name *
+find_name(struct bay *bay, const char *name)
 {
-	struct bay_chan *bchan = NULL;
-	HASH_FIND_STR(bay->channels, name, bchan);
+	struct bay_name *bname = NULL;
+	HASH_FIND_STR(bay->names, name, bname);
 
-	return bchan;
+	return bname;
 }
 
 struct chan *
 bay_find(struct bay *bay, const char *name)
 {
-	struct bay_chan *bchan = find_bay_chan(bay, name);
+	struct bay_name *bname = find_name(bay, name);
 
-	if (bchan != NULL)
-		return bchan->chan;
+	if (bname != NULL)
+		return bay->channels[bname->id].chan;
 	else
 		return NULL;
 }
@@ -57,24 +138,42 @@ bay_find(struct bay *bay, const char *name)
 int
 bay_register(struct bay *bay, struct chan *chan)
 {
-	struct bay_chan *bchan = find_bay_chan(bay, chan->name);
-	if (bchan != NULL) {
+	if (find_name(bay, chan->name) != NULL) {
 		err("channel %s already registered", chan->name);
 		return -1;
 	}
 
-	bchan = calloc(1, sizeof(struct bay_chan));
-	if (bchan == NULL) {
+	if (bay->nchannels >= bay->maxchannels) {
+		long n = bay->maxchannels == 0 ? 1024 : bay->maxchannels * 2;
+		struct bay_chan *channels = realloc(bay->channels,
+				(size_t) n * sizeof(struct bay_chan));
+		if (channels == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		bay->channels = channels;
+		bay->maxchannels = n;
+	}
+
+	struct bay_name *bname = calloc(1, sizeof(struct bay_name));
+	if (bname == NULL) {
 		err("calloc failed:");
 		return -1;
 	}
 
+	long id = bay->nchannels++;
+	struct bay_chan *bchan = &bay->channels[id];
+	memset(bchan, 0, sizeof(struct bay_chan));
 	bchan->chan = chan;
-	bchan->bay = bay;
-	chan_set_dirty_cb(chan, cb_chan_is_dirty, bchan);
 
-	/* Add to hash table */
-	HASH_ADD_STR(bay->channels, chan->name, bchan);
+	chan->id = id;
+	chan_set_dirty_cb(chan, cb_chan_is_dirty, bay);
+	bay->compiled = 0;
+
+	/* Add to the name index */
+	bname->name = chan->name;
+	bname->id = id;
+	HASH_ADD_KEYPTR(hh, bay->names, bname->name, strlen(bname->name), bname);
 
 	dbg("registered %s", chan->name);
 
@@ -90,7 +189,7 @@ bay_add_cb(struct bay *bay, enum bay_cb_type type,
 		return NULL;
 	}
 
-	struct bay_chan *bchan = find_bay_chan(bay, chan->name);
+	struct bay_chan *bchan = get_bay_chan(bay, chan);
 	if (bchan == NULL) {
 		err("cannot find channel %s in bay", chan->name);
 		return NULL;
@@ -105,7 +204,8 @@ bay_add_cb(struct bay *bay, enum bay_cb_type type,
 
 	cb->func = func;
 	cb->arg = arg;
-	cb->bchan = bchan;
+	cb->bay = bay;
+	cb->id = chan->id;
 	cb->type = (int) type;
 	cb->enabled = 0;
 
@@ -115,6 +215,24 @@ bay_add_cb(struct bay *bay, enum bay_cb_type type,
 	return cb;
 }
 
+/* Returns the first enabled callback of the channel that calls the given
+ * function, or NULL if there is none */
+struct bay_cb *
+bay_find_cb(struct bay *bay, enum bay_cb_type type, struct chan *chan,
+		bay_cb_func_t func)
+{
+	struct bay_chan *bchan = get_bay_chan(bay, chan);
+	if (bchan == NULL)
+		return NULL;
+
+	for (int i = 0; i < bchan->ncallbacks[type]; i++) {
+		if (bchan->cb[type][i].func == func)
+			return bchan->cb[type][i].cb;
+	}
+
+	return NULL;
+}
+
 void
 bay_enable_cb(struct bay_cb *cb)
 {
@@ -123,11 +241,25 @@ bay_enable_cb(struct bay_cb *cb)
 
 	cb->enabled = 1;
 
-	struct bay_chan *bchan = cb->bchan;
+	struct bay_chan *bchan = &cb->bay->channels[cb->id];
 	if (bchan->is_dirty)
 		die("cannot change callbacks of dirty bay channel");
-	DL_APPEND(bchan->cb[cb->type], cb);
-	bchan->ncallbacks[cb->type]++;
+
+	int type = cb->type;
+	if (bchan->ncallbacks[type] >= bchan->maxcallbacks[type]) {
+		int n = bchan->maxcallbacks[type] == 0 ? 2 : bchan->maxcallbacks[type] * 2;
+		struct bay_slot *slots = realloc(bchan->cb[type],
+				(size_t) n * sizeof(struct bay_slot));
+		if (slots == NULL)
+			die("realloc failed:");
+		bchan->cb[type] = slots;
+		bchan->maxcallbacks[type] = n;
+	}
+
+	struct bay_slot *slot = &bchan->cb[type][bchan->ncallbacks[type]++];
+	slot->func = cb->func;
+	slot->arg = cb->arg;
+	slot->cb = cb;
 }
 
 void
@@ -138,11 +270,292 @@ bay_disable_cb(struct bay_cb *cb)
 
 	cb->enabled = 0;
 
-	struct bay_chan *bchan = cb->bchan;
+	struct bay_chan *bchan = &cb->bay->channels[cb->id];
 	if (bchan->is_dirty)
 		die("cannot change callbacks of dirty bay channel");
-	DL_DELETE(bchan->cb[cb->type], cb);
-	bchan->ncallbacks[cb->type]++;
+
+	/* Remove it keeping the order of the rest */
+	int type = cb->type;
+	struct bay_slot *slots = bchan->cb[type];
+	int n = bchan->ncallbacks[type];
+	for (int i = 0; i < n; i++) {
+		if (slots[i].cb != cb)
+			continue;
+
+		memmove(&slots[i], &slots[i + 1],
+				(size_t) (n - i - 1) * sizeof(struct bay_slot));
+		bchan->ncallbacks[type]--;
+		return;
+	}
+
+	die("enabled callback not found in bay channel");
+}
+
+int
+bay_add_task(struct bay *bay, struct bay_task *task, bay_task_func_t func,
+		void *arg)
+{
+	if (func == NULL) {
+		err("func is NULL");
+		return -1;
+	}
+
+	memset(task, 0, sizeof(struct bay_task));
+	task->func = func;
+	task->arg = arg;
+	task->id = bay->ntasks;
+
+	if (push_task(&bay->tasks, &bay->ntasks, &bay->maxtasks, task) != 0) {
+		err("push_task failed");
+		return -1;
+	}
+
+	bay->compiled = 0;
+
+	return 0;
+}
+
+/** Declares that the task reads the channel, so it runs in a level above
+ * the channel. */
+int
+bay_task_input(struct bay *bay, struct bay_task *task, struct chan *chan)
+{
+	struct bay_chan *bchan = get_bay_chan(bay, chan);
+	if (bchan == NULL) {
+		err("cannot find channel %s in bay", chan->name);
+		return -1;
+	}
+
+	if (push_task(&bchan->consumers, &bchan->nconsumers,
+				&bchan->maxconsumers, task) != 0) {
+		err("push_task failed");
+		return -1;
+	}
+
+	task->ninputs++;
+	bay->compiled = 0;
+
+	return 0;
+}
+
+/** Declares that the task writes the channel, so the channel is placed in
+ * the same level as the task. */
+int
+bay_task_output(struct bay *bay, struct bay_task *task, struct chan *chan)
+{
+	struct bay_chan *bchan = get_bay_chan(bay, chan);
+	if (bchan == NULL) {
+		err("cannot find channel %s in bay", chan->name);
+		return -1;
+	}
+
+	if (push_id(&task->outputs, &task->noutputs, &task->maxoutputs, chan->id) != 0) {
+		err("push_id failed");
+		return -1;
+	}
+
+	bchan->nproducers++;
+	bay->compiled = 0;
+
+	return 0;
+}
+
+/** Runs the task once all the channels of the levels below have been
+ * propagated. Deferring a pending task has no effect. */
+int
+bay_defer(struct bay *bay, struct bay_task *task)
+{
+	if (task->pending)
+		return 0;
+
+	task->pending = 1;
+
+	if (bay->state == BAY_PROPAGATING)
+		return enqueue_task(bay, task);
+
+	if (bay->state != BAY_READY) {
+		err("cannot defer task in current bay state");
+		return -1;
+	}
+
+	return push_task(&bay->deferred, &bay->ndeferred, &bay->maxdeferred, task);
+}
+
+/** Assigns a level to each channel and task, so the tasks only run after
+ * all their inputs are updated. The channels that are not written by any
+ * task are in the level 0, and each task is one level above its inputs.
+ * Fails if there is a cycle. */
+int
+bay_compile(struct bay *bay)
+{
+	long nchan = bay->nchannels;
+	long n = nchan + bay->ntasks;
+
+	/* Number of unprocessed inputs of each node */
+	long *indeg = calloc((size_t) n + 1, sizeof(long));
+	long *queue = calloc((size_t) n + 1, sizeof(long));
+	if (indeg == NULL || queue == NULL) {
+		err("calloc failed:");
+		free(indeg);
+		free(queue);
+		return -1;
+	}
+
+	for (long i = 0; i < nchan; i++) {
+		bay->channels[i].level = 0;
+		indeg[i] = bay->channels[i].nproducers;
+	}
+
+	for (long i = 0; i < bay->ntasks; i++) {
+		bay->tasks[i]->level = 0;
+		indeg[nchan + i] = bay->tasks[i]->ninputs;
+	}
+
+	long head = 0, tail = 0;
+	for (long i = 0; i < n; i++) {
+		if (indeg[i] == 0)
+			queue[tail++] = i;
+	}
+
+	int maxlevel = 0;
+	while (head < tail) {
+		long u = queue[head++];
+		if (u < nchan) {
+			struct bay_chan *bchan = &bay->channels[u];
+			for (long j = 0; j < bchan->nconsumers; j++) {
+				struct bay_task *task = bchan->consumers[j];
+				if (task->level < bchan->level + 1)
+					task->level = bchan->level + 1;
+				if (--indeg[nchan + task->id] == 0)
+					queue[tail++] = nchan + task->id;
+			}
+		} else {
+			struct bay_task *task = bay->tasks[u - nchan];
+			for (long j = 0; j < task->noutputs; j++) {
+				long id = task->outputs[j];
+				struct bay_chan *bchan = &bay->channels[id];
+				if (bchan->level < task->level)
+					bchan->level = task->level;
+				if (--indeg[id] == 0)
+					queue[tail++] = id;
+			}
+			if (task->level > maxlevel)
+				maxlevel = task->level;
+		}
+	}
+
+	if (tail < n) {
+		for (long i = 0; i < nchan; i++) {
+			if (indeg[i] != 0) {
+				err("cycle found in channel %s",
+						bay->channels[i].chan->name);
+				break;
+			}
+		}
+		free(indeg);
+		free(queue);
+		return -1;
+	}
+
+	free(indeg);
+	free(queue);
+
+	int nlevels = maxlevel + 1;
+	if (nlevels > bay->nlevels) {
+		struct bay_level *levels = realloc(bay->levels,
+				(size_t) nlevels * sizeof(struct bay_level));
+		if (levels == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		memset(&levels[bay->nlevels], 0,
+				(size_t) (nlevels - bay->nlevels) * sizeof(struct bay_level));
+		bay->levels = levels;
+		bay->nlevels = nlevels;
+	}
+
+	bay->compiled = 1;
+
+	dbg("compiled %ld channels and %ld tasks in %d levels",
+			nchan, bay->ntasks, nlevels);
+
+	return 0;
+}
+
+/** Drops the updates of the channel that don't change its value, as given
+ * by the filter, before running the emit callbacks. All the emit callbacks
+ * of the channel must ignore those updates, so when called several times
+ * the filter that drops less updates is kept. */
+int
+bay_filter(struct bay *bay, struct chan *chan, enum bay_filter filter)
+{
+	struct bay_chan *bchan = get_bay_chan(bay, chan);
+	if (bchan == NULL) {
+		err("cannot find channel %s in bay", chan->name);
+		return -1;
+	}
+
+	if (!bchan->filter_set || filter < bchan->filter)
+		bchan->filter = filter;
+
+	bchan->filter_set = 1;
+
+	return 0;
+}
+
+static int
+cmp_filtered(const void *a, const void *b)
+{
+	const struct bay_chan *ca = *(struct bay_chan *const *) a;
+	const struct bay_chan *cb = *(struct bay_chan *const *) b;
+
+	if (ca->nfiltered != cb->nfiltered)
+		return ca->nfiltered > cb->nfiltered ? -1 : 1;
+
+	return 0;
+}
+
+/* Number of channels shown in the report */
+#define REPORT_NCHANS 10
+
+/** Reports the updates dropped by the filters, with the channels that
+ * dropped the most */
+void
+bay_report(struct bay *bay)
+{
+	int64_t nemitted = 0, nfiltered = 0;
+	for (long i = 0; i < bay->nchannels; i++) {
+		nemitted += bay->channels[i].nemitted;
+		nfiltered += bay->channels[i].nfiltered;
+	}
+
+	if (nfiltered == 0)
+		return;
+
+	info("filtered %"PRIi64" of %"PRIi64" channel updates (%.1f%%)",
+			nfiltered, nemitted + nfiltered,
+			100.0 * (double) nfiltered / (double) (nemitted + nfiltered));
+
+	struct bay_chan **chans = calloc((size_t) bay->nchannels, sizeof(struct bay_chan *));
+	if (chans == NULL) {
+		err("calloc failed:");
+		return;
+	}
+
+	for (long i = 0; i < bay->nchannels; i++)
+		chans[i] = &bay->channels[i];
+
+	qsort(chans, (size_t) bay->nchannels, sizeof(struct bay_chan *), cmp_filtered);
+
+	for (long i = 0; i < bay->nchannels && i < REPORT_NCHANS; i++) {
+		struct bay_chan *bchan = chans[i];
+		if (bchan->nfiltered == 0)
+			break;
+		info("  %s: %"PRIi64" of %"PRIi64, bchan->chan->name,
+				bchan->nfiltered, bchan->nemitted + bchan->nfiltered);
+	}
+
+	free(chans);
 }
 
 void
@@ -152,6 +565,52 @@ bay_init(struct bay *bay)
 	bay->state = BAY_READY;
 }
 
+/* Finds the slot after the given callback, which was at index i before
+ * running it. */
+static inline int
+next_slot(struct bay_chan *bchan, enum bay_cb_type type, int i,
+		struct bay_cb *cb)
+{
+	struct bay_slot *slots = bchan->cb[type];
+
+	if (likely(i < bchan->ncallbacks[type] && slots[i].cb == cb))
+		return i + 1;
+
+	/* Previous callbacks were removed */
+	for (int j = i - 1; j >= 0; j--) {
+		if (slots[j].cb == cb)
+			return j + 1;
+	}
+
+	/* Removed itself, the next one took its place */
+	return i;
+}
+
+/* Tells if the update must be dropped, otherwise it is emitted. The
+ * values are compared by the integer, which holds the bits of the double
+ * values too. */
+static inline int
+filter_chan(struct bay_chan *bchan)
+{
+	struct value value;
+	if (chan_read(bchan->chan, &value) != 0)
+		return 0;
+
+	int same = bchan->emitted && value.type == bchan->last.type
+		&& value.i == bchan->last.i;
+
+	if (same && (bchan->filter == BAY_FILTER_SAME || value.type == VALUE_NULL)) {
+		bchan->nfiltered++;
+		return 1;
+	}
+
+	bchan->last = value;
+	bchan->emitted = 1;
+	bchan->nemitted++;
+
+	return 0;
+}
+
 static int
 propagate_chan(struct bay_chan *bchan, enum bay_cb_type type)
 {
@@ -165,38 +624,106 @@ propagate_chan(struct bay_chan *bchan, enum bay_cb_type type)
 	dbg("- propagating channel '%s' phase %s",
 			bchan->chan->name, propname[type]);
 
-	struct bay_cb *cur = NULL;
-	/* New callbacks cannot be added while propagating a bay_chan */
-	DL_FOREACH(bchan->cb[type], cur) {
+	/* The callbacks may enable or disable other callbacks of the same
+	 * channel, which are appended or removed from the array as we go */
+	for (int i = 0; i < bchan->ncallbacks[type]; ) {
+		struct bay_slot *cur = &bchan->cb[type][i];
+		struct bay_cb *cb = cur->cb;
 		dbg("calling cb %"PRIxPTR, (uintptr_t) cur->func);
 		if (cur->func(bchan->chan, cur->arg) != 0) {
 			err("callback failed for %s", bchan->chan->name);
 			return -1;
 		}
+		i = next_slot(bchan, type, i, cb);
+	}
+
+	return 0;
+}
+
+/* Runs the tasks and the dirty callbacks of the channels in one level,
+ * which may add more channels and tasks to this level or the ones above */
+static int
+propagate_level(struct bay *bay, struct bay_level *lvl)
+{
+	long it = 0, ic = 0;
+
+	while (it < lvl->ntasks || ic < lvl->nchans) {
+		/* The tasks go first, as they write the channels of
+		 * this level */
+		for (; it < lvl->ntasks; it++) {
+			struct bay_task *task = lvl->tasks[it];
+			task->pending = 0;
+			if (task->func(task->arg) != 0) {
+				err("task failed");
+				return -1;
+			}
+		}
+
+		for (; ic < lvl->nchans; ic++) {
+			struct bay_chan *cur = &bay->channels[lvl->chans[ic]];
+			if (propagate_chan(cur, BAY_CB_DIRTY) != 0) {
+				err("propagate_chan failed");
+				return -1;
+			}
+		}
 	}
 
+	lvl->ntasks = 0;
+	lvl->nchans = 0;
+
 	return 0;
 }
 
 int
 bay_propagate(struct bay *bay)
 {
-	struct bay_chan *cur;
+	if (!bay->compiled && bay_compile(bay) != 0) {
+		err("bay_compile failed");
+		return -1;
+	}
+
 	bay->state = BAY_PROPAGATING;
-	DL_FOREACH(bay->dirty, cur) {
-		/* May add more dirty channels */
-		if (propagate_chan(cur, BAY_CB_DIRTY) != 0) {
-			err("propagate_chan failed");
+	bay->curlevel = 0;
+
+	/* Place the channels and tasks that were added before in their
+	 * levels */
+	for (long i = 0; i < bay->ndirty; i++) {
+		if (enqueue_chan(bay, bay->dirty[i]) != 0) {
+			err("enqueue_chan failed");
+			return -1;
+		}
+	}
+
+	for (long i = 0; i < bay->ndeferred; i++) {
+		if (enqueue_task(bay, bay->deferred[i]) != 0) {
+			err("enqueue_task failed");
 			return -1;
 		}
 	}
+	bay->ndeferred = 0;
+
+	for (int i = 0; i < bay->nlevels; i++) {
+		bay->curlevel = i;
+		if (propagate_level(bay, &bay->levels[i]) != 0) {
+			err("propagate_level failed");
+			return -1;
+		}
+	}
+
+	bay->curlevel = 0;
 
 	dbg("<> dirty phase complete");
 
 	/* Once the dirty callbacks have been propagated,
 	 * begin the emit stage */
 	bay->state = BAY_EMITTING;
-	DL_FOREACH(bay->dirty, cur) {
+	for (long i = 0; i < bay->ndirty; i++) {
+		struct bay_chan *cur = &bay->channels[bay->dirty[i]];
+		if (cur->filter != BAY_FILTER_NONE
+				&& cur->ncallbacks[BAY_CB_EMIT] > 0
+				&& filter_chan(cur))
+			continue;
+
 		/* Cannot add more dirty channels */
 		if (propagate_chan(cur, BAY_CB_EMIT) != 0) {
 			err("propagate_chan failed");
@@ -210,7 +737,8 @@ bay_propagate(struct bay *bay)
 	 * callbacks, so we capture any potential double write when
 	 * running the callbacks */
 	bay->state = BAY_FLUSHING;
-	DL_FOREACH(bay->dirty, cur) {
+	for (long i = 0; i < bay->ndirty; i++) {
+		struct bay_chan *cur = &bay->channels[bay->dirty[i]];
 		if (chan_flush(cur->chan) != 0) {
 			err("chan_flush failed");
 			return -1;
@@ -218,7 +746,7 @@ bay_propagate(struct bay *bay)
 		cur->is_dirty = 0;
 	}
 
-	bay->dirty = NULL;
+	bay->ndirty = 0;
 	bay->state = BAY_READY;
 
 	return 0;
@@ -4,8 +4,10 @@
 #ifndef BAY_H
 #define BAY_H
 
+#include <stdint.h>
 #include "common.h"
 #include "uthash.h"
+#include "value.h"
 struct chan;
 
 /* Handle connections between channels and callbacks */
@@ -16,35 +18,93 @@ enum bay_cb_type {
 	BAY_CB_MAX,
 };
 
+/* Updates of a channel dropped before the emit callbacks, when all of
+ * them would ignore it, as set by bay_filter() */
+enum bay_filter {
+	BAY_FILTER_NONE = 0,  /* Emit all the updates */
+	BAY_FILTER_NULL,      /* Drop a null value after null */
+	BAY_FILTER_SAME,      /* Drop the same value as the last emitted */
+};
+
 typedef int (*bay_cb_func_t)(struct chan *chan, void *ptr);
 
 struct bay_cb {
 	bay_cb_func_t func;
 	void *arg;
-	struct bay_chan *bchan;
+	struct bay *bay;
+	long id; /* Of the bay channel */
 	int enabled;
 	int type;
+};
+
+/* Enabled callback, stored in the channel array */
+struct bay_slot {
+	bay_cb_func_t func;
+	void *arg;
+	struct bay_cb *cb;
+};
+
+typedef int (*bay_task_func_t)(void *arg);
+
+/* Work that reads some input channels and writes some output channels,
+ * like a mux or a sort. It is deferred until all the inputs have been
+ * updated, so it only runs once per propagation. */
+struct bay_task {
+	bay_task_func_t func;
+	void *arg;
+	long id;
+	int level;
+	int pending;
+	long ninputs;
 
-	/* List of callbacks in one channel */
-	struct bay_cb *next;
-	struct bay_cb *prev;
+	/* Ids of the output channels */
+	long *outputs;
+	long noutputs;
+	long maxoutputs;
+};
+
+/* Channels and tasks waiting to be processed in a level */
+struct bay_level {
+	long *chans;
+	long nchans;
+	long maxchans;
+	struct bay_task **tasks;
+	long ntasks;
+	long maxtasks;
 };
 
 #define MAX_BAY_NAME 1024
 
 struct bay_chan {
 	struct chan *chan;
+
+	/* Enabled callbacks in the order they were enabled */
 	int ncallbacks[BAY_CB_MAX];
-	struct bay_cb *cb[BAY_CB_MAX];
-	struct bay *bay;
+	int maxcallbacks[BAY_CB_MAX];
+	struct bay_slot *cb[BAY_CB_MAX];
 	int is_dirty;
 
-	/* Global hash table with all channels in bay */
-	UT_hash_handle hh;
+	/* Change filter of the emit callbacks */
+	enum bay_filter filter;
+	int filter_set;
+	int emitted; /* The last value is valid */
+	struct value last; /* Last emitted value */
+	int64_t nemitted;
+	int64_t nfiltered;
 
-	/* Used by dirty list */
-	struct bay_chan *next;
-	struct bay_chan *prev;
+	/* Position in the propagation plan */
+	int level;
+	long nproducers;
+	struct bay_task **consumers;
+	long nconsumers;
+	long maxconsumers;
+};
+
+/* Index of the channels by name, only used to find them by name */
+struct bay_name {
+	const char *name;
+	long id;
+	UT_hash_handle hh;
 };
 
 enum bay_state {
@@ -57,8 +117,29 @@ enum bay_state {
 
 struct bay {
 	enum bay_state state;
+
+	/* Channels indexed by the id given at registration */
 	struct bay_chan *channels;
-	struct bay_chan *dirty;
+	long nchannels;
+	long maxchannels;
+	struct bay_name *names;
+
+	/* Ids of the dirty channels */
+	long *dirty;
+	long ndirty;
+	long maxdirty;
+
+	/* Propagation plan, computed by bay_compile() */
+	struct bay_task **tasks;
+	long ntasks;
+	long maxtasks;
+	struct bay_task **deferred;
+	long ndeferred;
+	long maxdeferred;
+	struct bay_level *levels;
+	int nlevels;
+	int curlevel;
+	int compiled;
 };
 
         void bay_init(struct bay *bay);
@@ -68,7 +149,16 @@ USE_RET int bay_propagate(struct bay *bay);
 USE_RET struct chan *bay_find(struct bay *bay, const char *name);
 USE_RET struct bay_cb *bay_add_cb(struct bay *bay, enum bay_cb_type type,
 		struct chan *chan, bay_cb_func_t func, void *arg, int enabled);
+USE_RET struct bay_cb *bay_find_cb(struct bay *bay, enum bay_cb_type type,
+		struct chan *chan, bay_cb_func_t func);
         void bay_enable_cb(struct bay_cb *cb);
         void bay_disable_cb(struct bay_cb *cb);
+USE_RET int bay_add_task(struct bay *bay, struct bay_task *task, bay_task_func_t func, void *arg);
+USE_RET int bay_task_input(struct bay *bay, struct bay_task *task, struct chan *chan);
+USE_RET int bay_task_output(struct bay *bay, struct bay_task *task, struct chan *chan);
+USE_RET int bay_defer(struct bay *bay, struct bay_task *task);
+USE_RET int bay_compile(struct bay *bay);
+USE_RET int bay_filter(struct bay *bay, struct chan *chan, enum bay_filter filter);
+        void bay_report(struct bay *bay);
 
 #endif /* BAY_H */
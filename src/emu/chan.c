@@ -4,8 +4,40 @@
 #include "chan.h"
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include "common.h"
+#include "uthash.h"
+
+/* Names of all channels, so each one is only stored once */
+struct name {
+	UT_hash_handle hh;
+	char str[];
+};
+
+static struct name *names = NULL;
+static struct chan_stats stats;
+
+static const char *
+intern(const char *str)
+{
+	struct name *name = NULL;
+	size_t len = strlen(str);
+
+	HASH_FIND(hh, names, str, len, name);
+	if (name != NULL)
+		return name->str;
+
+	name = malloc(sizeof(struct name) + len + 1);
+	if (name == NULL)
+		die("malloc failed:");
+
+	memcpy(name->str, str, len + 1);
+	HASH_ADD_KEYPTR(hh, names, name->str, len, name);
+	stats.name_bytes += (int64_t) (sizeof(struct name) + len + 1);
+
+	return name->str;
+}
 
 void
 chan_init(struct chan *chan, enum chan_type type, const char *fmt, ...)
@@ -15,15 +47,26 @@ chan_init(struct chan *chan, enum chan_type type, const char *fmt, ...)
 	va_list ap;
 	va_start(ap, fmt);
 
-	size_t n = ARRAYLEN(chan->name);
-	int ret = vsnprintf(chan->name, n, fmt, ap);
+	char name[MAX_CHAN_NAME];
+	size_t n = ARRAYLEN(name);
+	int ret = vsnprintf(name, n, fmt, ap);
 	if (ret < 0)
 		die("vsnprintf failed");
 	else if ((size_t) ret >= n)
 		die("channel name too long");
 	va_end(ap);
 
+	chan->name = intern(name);
 	chan->type = type;
+
+	stats.nchan++;
+	stats.chan_bytes += (int64_t) sizeof(struct chan);
+}
+
+void
+chan_stats_get(struct chan_stats *s)
+{
+	*s = stats;
 }
 
 void
@@ -103,6 +146,34 @@ chan_set(struct chan *chan, struct value value)
 	return 0;
 }
 
+static int
+grow_stack(struct chan *chan)
+{
+	struct chan_stack *stack = &chan->data.stack;
+
+	if (stack->max >= MAX_CHAN_STACK) {
+		err("%s: channel stack full", chan->name);
+		return -1;
+	}
+
+	int max = stack->max == 0 ? 8 : stack->max * 2;
+	if (max > MAX_CHAN_STACK)
+		max = MAX_CHAN_STACK;
+
+	struct value *values = realloc(stack->values,
+			(size_t) max * sizeof(struct value));
+	if (values == NULL) {
+		err("realloc failed:");
+		return -1;
+	}
+
+	stats.stack_bytes += (int64_t) (max - stack->max) * (int64_t) sizeof(struct value);
+	stack->values = values;
+	stack->max = max;
+
+	return 0;
+}
+
 /** Adds one value to the stack. Fails if the stack is full.
  *
  *  @param ivalue The new integer value to be added on the stack.
@@ -139,8 +210,8 @@ chan_push(struct chan *chan, struct value value)
 
 	struct chan_stack *stack = &chan->data.stack;
 
-	if (stack->n >= MAX_CHAN_STACK) {
-		err("%s: channel stack full", chan->name);
+	if (stack->n >= stack->max && grow_stack(chan) != 0) {
+		err("%s: grow_stack failed", chan->name);
 		return -1;
 	}
 
@@ -4,10 +4,12 @@
 #ifndef CHAN_H
 #define CHAN_H
 
+#include <stdint.h>
 #include "common.h"
 #include "value.h"
 struct chan;
 
+/* Values are allocated as the stack grows, up to this limit */
 #define MAX_CHAN_STACK 512
 #define MAX_CHAN_NAME 512
 
@@ -32,7 +34,8 @@ struct chan_spec {
 
 struct chan_stack {
 	int n;
-	struct value values[MAX_CHAN_STACK];
+	int max;
+	struct value *values;
 };
 
 union chan_data {
@@ -50,7 +53,16 @@ struct chan {
 	struct value last_value;
 	enum chan_type type;
 	union chan_data data;
-	char name[MAX_CHAN_NAME];
+	const char *name; /* Interned, shared among channels */
+	long id; /* Given by the bay when registered */
+};
+
+/* Memory used by all the channels */
+struct chan_stats {
+	int64_t nchan;
+	int64_t chan_bytes;
+	int64_t stack_bytes;
+	int64_t name_bytes;
 };
 
 /** Reads the current value of a channel */
@@ -80,5 +92,6 @@ USE_RET int chan_flush(struct chan *chan);
 USE_RET int chan_prop_get(struct chan *chan, enum chan_prop prop);
         void chan_set_dirty_cb(struct chan *chan, chan_cb_t func, void *arg);
 USE_RET int chan_dirty(struct chan *chan);
+        void chan_stats_get(struct chan_stats *stats);
 
 #endif /* CHAN_H */
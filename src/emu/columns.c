@@ -0,0 +1,316 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "columns.h"
+#include <stdlib.h>
+#include <string.h>
+#include "bay.h"
+#include "chan.h"
+#include "pv/prv.h"
+#include "value.h"
+#include "varint.h"
+
+/* Writes the chunk being filled of the series */
+static int
+flush_chunk(struct columns *cols, struct columns_chan *c)
+{
+	if (c->n == 0)
+		return 0;
+
+	if (cols->nchunks == cols->maxchunks) {
+		long n = cols->maxchunks ? cols->maxchunks * 2 : 256;
+		struct columns_chunk *chunks = realloc(cols->chunks,
+				(size_t) n * sizeof(struct columns_chunk));
+		if (chunks == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		cols->chunks = chunks;
+		cols->maxchunks = n;
+	}
+
+	struct columns_chunk *chunk = &cols->chunks[cols->nchunks++];
+	chunk->series = c->id;
+	chunk->offset = (int64_t) ftello(cols->f);
+	chunk->nvalues = c->n;
+	chunk->first_time = c->first_time;
+	chunk->tsize = (int64_t) c->tsize;
+	chunk->vsize = (int64_t) c->vsize;
+
+	if (fwrite(c->times, c->tsize, 1, cols->f) != 1
+			|| fwrite(c->values, c->vsize, 1, cols->f) != 1) {
+		err("fwrite failed:");
+		return -1;
+	}
+
+	cols->series[c->id].nvalues += c->n;
+	cols->series[c->id].nchunks++;
+
+	/* The deltas start again from zero */
+	c->n = 0;
+	c->tsize = 0;
+	c->vsize = 0;
+	c->last_time = 0;
+	c->last_value = 0;
+
+	return 0;
+}
+
+/* Grows the buffers of the series up to the chunk size, as most series
+ * only have a few values */
+static int
+reserve(struct columns_chan *c)
+{
+	size_t used = c->tsize > c->vsize ? c->tsize : c->vsize;
+	if (used + VARINT_MAX <= c->cap)
+		return 0;
+
+	size_t cap = c->cap ? c->cap * 2 : 256;
+	if (cap > COLUMNS_CHUNK + VARINT_MAX)
+		cap = COLUMNS_CHUNK + VARINT_MAX;
+
+	char *times = realloc(c->times, cap);
+	if (times == NULL) {
+		err("realloc failed:");
+		return -1;
+	}
+	c->times = times;
+
+	char *values = realloc(c->values, cap);
+	if (values == NULL) {
+		err("realloc failed:");
+		return -1;
+	}
+	c->values = values;
+	c->cap = cap;
+
+	return 0;
+}
+
+static int
+append(struct columns *cols, struct columns_chan *c, int64_t value)
+{
+	if (c->tsize > COLUMNS_CHUNK || c->vsize > COLUMNS_CHUNK) {
+		if (flush_chunk(cols, c) != 0)
+			return -1;
+	}
+
+	if (reserve(c) != 0)
+		return -1;
+
+	if (c->n == 0)
+		c->first_time = cols->time;
+
+	char *p = varint_put_u64(c->times + c->tsize,
+			(uint64_t) (cols->time - c->last_time));
+	c->tsize = (size_t) (p - c->times);
+
+	/* Wraps around like the decoder */
+	int64_t delta = (int64_t) ((uint64_t) value - (uint64_t) c->last_value);
+	p = varint_put_i64(c->values + c->vsize, delta);
+	c->vsize = (size_t) (p - c->values);
+
+	c->last_time = cols->time;
+	c->last_value = value;
+	c->n++;
+
+	return 0;
+}
+
+static int
+cb_columns(struct chan *chan, void *ptr)
+{
+	struct columns_chan *c = ptr;
+	struct value value;
+	if (chan_read(chan, &value) != 0) {
+		err("chan_read %s failed", chan->name);
+		return -1;
+	}
+
+	int64_t val = prv_value(&value, c->flags);
+
+	/* Only the changes, unless the duplicates are emitted */
+	if (c->set && val == c->value && (~c->flags & PRV_EMITDUP))
+		return 0;
+
+	c->value = val;
+	c->set = 1;
+
+	return append(c->cols, c, val);
+}
+
+int
+columns_open(struct columns *cols, long nrows, const char *path)
+{
+	memset(cols, 0, sizeof(struct columns));
+
+	cols->nrows = nrows;
+	cols->f = fopen(path, "w");
+	if (cols->f == NULL) {
+		err("cannot open file '%s' for writting:", path);
+		return -1;
+	}
+
+	/* Fake header to allocate the space */
+	struct columns_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	if (fwrite(&hdr, sizeof(hdr), 1, cols->f) != 1) {
+		err("fwrite failed:");
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+columns_register(struct columns *cols, long row, long type,
+		struct bay *bay, struct chan *chan, long flags)
+{
+	if (row < 0 || row >= cols->nrows) {
+		err("row %ld out of bounds", row);
+		return -1;
+	}
+
+	if (cols->nseries == cols->maxseries) {
+		long n = cols->maxseries ? cols->maxseries * 2 : 64;
+		struct columns_series *series = realloc(cols->series,
+				(size_t) n * sizeof(struct columns_series));
+		if (series == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		cols->series = series;
+
+		struct columns_chan **chans = realloc(cols->chans,
+				(size_t) n * sizeof(struct columns_chan *));
+		if (chans == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		cols->chans = chans;
+		cols->maxseries = n;
+	}
+
+	struct columns_chan *c = calloc(1, sizeof(struct columns_chan));
+	if (c == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	c->cols = cols;
+	c->chan = chan;
+	c->flags = flags;
+	c->id = cols->nseries;
+
+	struct columns_series *s = &cols->series[cols->nseries];
+	memset(s, 0, sizeof(*s));
+	s->row = row;
+	s->type = type;
+
+	cols->chans[cols->nseries++] = c;
+
+	if (bay_add_cb(bay, BAY_CB_EMIT, chan, cb_columns, c, 1) == NULL) {
+		err("bay_add_cb failed");
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+columns_advance(struct columns *cols, int64_t time)
+{
+	if (time < cols->time) {
+		err("cannot move to previous time");
+		return -1;
+	}
+
+	cols->time = time;
+	return 0;
+}
+
+static int
+cmp_chunk(const void *a, const void *b)
+{
+	const struct columns_chunk *ca = a;
+	const struct columns_chunk *cb = b;
+
+	if (ca->series != cb->series)
+		return ca->series < cb->series ? -1 : 1;
+
+	/* The chunks of a series are written in time order */
+	if (ca->offset != cb->offset)
+		return ca->offset < cb->offset ? -1 : 1;
+
+	return 0;
+}
+
+/* Writes the remaining chunks and the index */
+int
+columns_close(struct columns *cols)
+{
+	int ret = -1;
+
+	for (long i = 0; i < cols->nseries; i++) {
+		if (flush_chunk(cols, cols->chans[i]) != 0)
+			goto out;
+	}
+
+	qsort(cols->chunks, (size_t) cols->nchunks,
+			sizeof(struct columns_chunk), cmp_chunk);
+
+	int64_t first = 0;
+	for (long i = 0; i < cols->nseries; i++) {
+		cols->series[i].first_chunk = first;
+		first += cols->series[i].nchunks;
+	}
+
+	struct columns_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, COLUMNS_MAGIC, sizeof(hdr.magic));
+	hdr.version = COLUMNS_VERSION;
+	hdr.nrows = cols->nrows;
+	hdr.nseries = cols->nseries;
+	hdr.nchunks = cols->nchunks;
+	hdr.index = (int64_t) ftello(cols->f);
+
+	if (cols->nseries > 0 && fwrite(cols->series, sizeof(struct columns_series),
+				(size_t) cols->nseries, cols->f) != (size_t) cols->nseries) {
+		err("fwrite failed:");
+		goto out;
+	}
+
+	if (cols->nchunks > 0 && fwrite(cols->chunks, sizeof(struct columns_chunk),
+				(size_t) cols->nchunks, cols->f) != (size_t) cols->nchunks) {
+		err("fwrite failed:");
+		goto out;
+	}
+
+	if (fseeko(cols->f, 0, SEEK_SET) != 0
+			|| fwrite(&hdr, sizeof(hdr), 1, cols->f) != 1) {
+		err("cannot write header:");
+		goto out;
+	}
+
+	ret = 0;
+
+out:
+	if (fclose(cols->f) != 0) {
+		err("fclose failed:");
+		ret = -1;
+	}
+
+	for (long i = 0; i < cols->nseries; i++) {
+		free(cols->chans[i]->times);
+		free(cols->chans[i]->values);
+		cols->chans[i]->times = NULL;
+		cols->chans[i]->values = NULL;
+		cols->chans[i]->cap = 0;
+	}
+	free(cols->series);
+	free(cols->chunks);
+	cols->series = NULL;
+	cols->chunks = NULL;
+
+	return ret;
+}
@@ -0,0 +1,103 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#ifndef COLUMNS_H
+#define COLUMNS_H
+
+/* Exports the changes of the channels registered in a PRV file as time
+ * series, so they can be analyzed without parsing the PRV. Each channel
+ * is a series with the row and type of the PRV, stored in chunks with
+ * the times followed by the values. The times are unsigned varints
+ * (LEB128) of the delta with the previous time and the values zigzag
+ * encoded varints of the delta with the previous value, both starting
+ * from zero in each chunk, see varint.h. The values are the ones written
+ * in the PRV.
+ *
+ * The file starts with a struct columns_header and ends with the index:
+ * nseries struct columns_series followed by nchunks struct columns_chunk,
+ * where the chunks of each series are contiguous and sorted by time. All
+ * the integers of the header and the index use the host byte order. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "common.h"
+struct bay;
+struct chan;
+
+#define COLUMNS_MAGIC "ovnicol"
+#define COLUMNS_VERSION 1
+
+/* Bytes of the times or values of a series before writing its chunk */
+#define COLUMNS_CHUNK (64*1024)
+
+struct columns_header {
+	char magic[8];
+	int64_t version;
+	int64_t nrows;
+	int64_t nseries;
+	int64_t nchunks;
+	int64_t index; /* Offset of the index */
+};
+
+struct columns_series {
+	int64_t row;
+	int64_t type;
+	int64_t nvalues;
+	int64_t first_chunk;
+	int64_t nchunks;
+};
+
+struct columns_chunk {
+	int64_t series;
+	int64_t offset;
+	int64_t nvalues;
+	int64_t first_time;
+	int64_t tsize; /* Bytes of the times */
+	int64_t vsize; /* Bytes of the values, after the times */
+};
+
+/* Series of one channel, with the chunk being filled */
+struct columns_chan {
+	struct columns *cols;
+	struct chan *chan;
+	long flags; /* As in prv_register() */
+	long id;
+
+	int64_t value; /* Last recorded */
+	int set; /* Some value was recorded */
+
+	/* Bases of the deltas in the chunk */
+	int64_t last_time;
+	int64_t last_value;
+
+	int64_t first_time;
+	int64_t n;
+	char *times;
+	char *values;
+	size_t tsize;
+	size_t vsize;
+	size_t cap; /* Of both buffers */
+};
+
+struct columns {
+	FILE *f;
+	int64_t time;
+	long nrows;
+
+	struct columns_series *series;
+	struct columns_chan **chans;
+	long nseries;
+	long maxseries;
+
+	struct columns_chunk *chunks;
+	long nchunks;
+	long maxchunks;
+};
+
+USE_RET int columns_open(struct columns *cols, long nrows, const char *path);
+USE_RET int columns_register(struct columns *cols, long row, long type,
+		struct bay *bay, struct chan *chan, long flags);
+USE_RET int columns_advance(struct columns *cols, int64_t time);
+USE_RET int columns_close(struct columns *cols);
+
+#endif /* COLUMNS_H */
@@ -3,8 +3,11 @@
 
 #include "emu.h"
 #include <string.h>
+#include "chan.h"
 #include "emu_ev.h"
+#include "loom.h"
 #include "models.h"
+#include "pv/pvt.h"
 #include "stream.h"
 
 int
@@ -15,7 +18,14 @@ emu_init(struct emu *emu, int argc, char *argv[])
 	emu_args_init(&emu->args, argc, argv);
 
 	/* Load the streams into the trace */
-	if (trace_load(&emu->trace, emu->args.tracedir) != 0) {
+	int ret;
+	if (emu->args.read_budget > 0)
+		ret = trace_load_bounded(&emu->trace, emu->args.tracedir,
+				emu->args.read_budget);
+	else
+		ret = trace_load(&emu->trace, emu->args.tracedir);
+
+	if (ret != 0) {
 		err("cannot load trace '%s'", emu->args.tracedir);
 		return -1;
 	}
@@ -27,12 +37,28 @@ emu_init(struct emu *emu, int argc, char *argv[])
 		return -1;
 	}
 
+	long flags = 0;
+	if (emu->args.binary)
+		flags |= PVT_BINARY;
+	if (emu->args.perfetto)
+		flags |= PVT_PERFETTO;
+	if (emu->args.columns)
+		flags |= PVT_COLUMNS;
+	if (emu->args.profile)
+		flags |= PVT_PROFILE;
+	if (emu->args.no_prv)
+		flags |= PVT_NOPRV;
+
 	/* Place output inside the same tracedir directory */
-	if (recorder_init(&emu->recorder, emu->args.tracedir) != 0) {
+	if (recorder_init(&emu->recorder, emu->args.tracedir, flags) != 0) {
 		err("recorder_init failed");
 		return -1;
 	}
 
+	emu->recorder.coalesce = emu->args.coalesce;
+	emu->recorder.shard_ns = emu->args.shard_ns;
+	emu->recorder.shard_bytes = emu->args.shard_bytes;
+
 	/* Initialize the bay */
 	bay_init(&emu->bay);
 
@@ -48,6 +74,17 @@ emu_init(struct emu *emu, int argc, char *argv[])
 		return -1;
 	}
 
+	emu->part = -1;
+	emu->nparts = 1;
+	if (emu->args.nworkers > 1) {
+		emu->nparts = system_partition(&emu->system, &emu->trace,
+				emu->args.nworkers);
+		if (emu->nparts < 0) {
+			err("system_partition failed");
+			return -1;
+		}
+	}
+
 	model_init(&emu->model);
 
 	/* Register all the models */
@@ -79,6 +116,13 @@ emu_connect(struct emu *emu)
 		return -1;
 	}
 
+	/* The channel graph doesn't change from now on, so compute the
+	 * order in which the channels are propagated */
+	if (bay_compile(&emu->bay) != 0) {
+		err("bay_compile failed");
+		return -1;
+	}
+
 	/* Run a propagation phase so we clean all the dirty channels, in
 	 * particular the select channel of the muxes */
 	if (bay_propagate(&emu->bay) != 0) {
@@ -86,14 +130,25 @@ emu_connect(struct emu *emu)
 		return -1;
 	}
 
+	if (recorder_commit(&emu->recorder) != 0) {
+		err("recorder_commit failed");
+		return -1;
+	}
+
 	return 0;
 }
 
 static int
 set_current(struct emu *emu)
 {
-	emu->ev = player_ev(&emu->player);
-	emu->stream = player_stream(&emu->player);
+	if (emu->args.pipeline) {
+		emu->ev = &emu->pipe_ev.ev;
+		emu->stream = emu->pipe_ev.stream;
+	} else {
+		emu->ev = player_ev(&emu->player);
+		emu->stream = player_stream(&emu->player);
+	}
+
 	struct lpt *lpt = system_get_lpt(emu->stream);
 	if (lpt == NULL) {
 		/* For now die if we have a unknown stream */
@@ -126,18 +181,38 @@ panic(struct emu *emu)
 	}
 
 	if (emu->stream != NULL) {
+		/* The decoder thread keeps reading the stream */
+		int64_t offset = emu->args.pipeline
+			? emu->pipe_ev.offset : emu->stream->offset;
 		err("stream: ");
 		err("  relpath=%s", emu->stream->relpath);
-		err("  offset=%"PRIi64, emu->stream->offset);
+		err("  offset=%"PRIi64, offset);
 		err("  clock_offset=%"PRIi64, emu->stream->clock_offset);
 	}
 	err("@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@@");
 }
 
+static int
+next_event(struct emu *emu)
+{
+	if (!emu->args.pipeline)
+		return player_step(&emu->player);
+
+	/* Start the threads on the first step, once the output files
+	 * are already set */
+	if (!emu->pipe.started && pipeline_start(&emu->pipe, &emu->player,
+				&emu->stat, &emu->recorder) != 0) {
+		err("pipeline_start failed");
+		return -1;
+	}
+
+	return pipeline_next(&emu->pipe, &emu->pipe_ev);
+}
+
 int
 emu_step(struct emu *emu)
 {
-	int ret = player_step(&emu->player);
+	int ret = next_event(emu);
 
 	/* No more events */
 	if (ret > 0) {
@@ -158,7 +233,9 @@ emu_step(struct emu *emu)
 
 	dbg("----- mcv=%s dclock=%"PRIi64" -----", emu->ev->mcv, emu->ev->dclock);
 
-	emu_stat_update(&emu->stat, &emu->player);
+	/* Otherwise updated by the decoder thread */
+	if (!emu->args.pipeline)
+		emu_stat_update(&emu->stat, &emu->player);
 
 	/* Advance recorder clock */
 	if (recorder_advance(&emu->recorder, emu->ev->dclock) != 0) {
@@ -179,13 +256,38 @@ emu_step(struct emu *emu)
 		return -1;
 	}
 
+	if (recorder_commit(&emu->recorder) != 0) {
+		err("recorder_commit failed");
+		return -1;
+	}
+
 	return 0;
 }
 
+static void
+report_chan_memory(void)
+{
+	struct chan_stats s;
+	chan_stats_get(&s);
+
+	info("%"PRIi64" channels use %"PRIi64" KiB (%"PRIi64" KiB stacks, %"PRIi64" KiB names)",
+			s.nchan,
+			(s.chan_bytes + s.stack_bytes + s.name_bytes) / 1024,
+			s.stack_bytes / 1024,
+			s.name_bytes / 1024);
+}
+
 int
 emu_finish(struct emu *emu)
 {
+	if (pipeline_stop(&emu->pipe) != 0) {
+		err("pipeline_stop failed");
+		return -1;
+	}
+
 	emu_stat_report(&emu->stat, &emu->player, 1);
+	report_chan_memory();
+	bay_report(&emu->bay);
 
 	int ret = 0;
 	if (model_finish(&emu->model, emu) != 0) {
@@ -201,3 +303,82 @@ emu_finish(struct emu *emu)
 
 	return ret;
 }
+
+static int
+in_part(struct stream *stream, void *arg)
+{
+	int part = *(int *) arg;
+	struct lpt *lpt = system_get_lpt(stream);
+
+	return lpt != NULL && lpt->loom->part == part;
+}
+
+/* Restricts the emulation to the looms of the given part and writes the
+ * output to its own files. Called by each worker after emu_connect(). */
+int
+emu_split(struct emu *emu, int part)
+{
+	emu->part = part;
+
+	system_select(&emu->system, part);
+
+	if (player_filter(&emu->player, in_part, &emu->part) != 0) {
+		err("player_filter failed");
+		return -1;
+	}
+
+	if (recorder_split(&emu->recorder, part) != 0) {
+		err("recorder_split failed");
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+emu_finish_part(struct emu *emu)
+{
+	if (pipeline_stop(&emu->pipe) != 0) {
+		err("pipeline_stop failed");
+		return -1;
+	}
+
+	emu_stat_report(&emu->stat, &emu->player, 1);
+
+	/* Each worker has its own bay */
+	bay_report(&emu->bay);
+
+	int ret = 0;
+	if (model_finish(&emu->model, emu) != 0) {
+		err("model_finish failed");
+		ret = -1;
+	}
+
+	if (recorder_finish_part(&emu->recorder, emu->part) != 0) {
+		err("recorder_finish_part failed");
+		ret = -1;
+	}
+
+	return ret;
+}
+
+/* Merges the output of all the parts and finishes the traces. The models
+ * have already been finished by each worker. */
+int
+emu_merge(struct emu *emu)
+{
+	report_chan_memory();
+
+	int ret = 0;
+	if (recorder_merge(&emu->recorder, emu->nparts) != 0) {
+		err("recorder_merge failed");
+		ret = -1;
+	}
+
+	if (recorder_finish(&emu->recorder) != 0) {
+		err("recorder_finish failed");
+		ret = -1;
+	}
+
+	return ret;
+}
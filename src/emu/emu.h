@@ -10,6 +10,7 @@
 #include "emu_stat.h"
 #include "extend.h"
 #include "model.h"
+#include "pipeline.h"
 #include "player.h"
 #include "recorder.h"
 #include "system.h"
@@ -25,9 +26,16 @@ struct emu {
 	struct model model;
 	struct recorder recorder;
 	struct emu_stat stat;
+	struct pipeline pipe;
+	struct pipeline_ev pipe_ev;
 
 	int finished;
 
+	/* Number of parts emulated in parallel and the one emulated by
+	 * this process, or -1 if all */
+	int nparts;
+	int part;
+
 	/* Quick access */
 	struct stream *stream;
 	struct emu_ev *ev;
@@ -42,5 +50,8 @@ USE_RET int emu_init(struct emu *emu, int argc, char *argv[]);
 USE_RET int emu_connect(struct emu *emu);
 USE_RET int emu_step(struct emu *emu);
 USE_RET int emu_finish(struct emu *emu);
+USE_RET int emu_split(struct emu *emu, int part);
+USE_RET int emu_finish_part(struct emu *emu);
+USE_RET int emu_merge(struct emu *emu);
 
 #endif /* EMU_H */
@@ -19,7 +19,7 @@ usage(void)
 {
 	rerr("%s -- version %s\n", progname, version);
 	rerr("\n");
-	rerr("Usage: %s [-c offsetfile] [-x xtasksfile] [-abdlh] tracedir\n", progname);
+	rerr("Usage: %s [-c offsetfile] [-x xtasksfile] [-m MiB] [-j N] [-s size] [-abdeglnphrtz] tracedir\n", progname);
 	rerr("\n");
 	rerr("Options:\n");
 	rerr("  -c offsetfile      Use the given offset file to correct\n");
@@ -34,9 +34,61 @@ usage(void)
 	rerr("\n");
 	rerr("  -x xtasksfile      xtasks configuration of fpga accelerators (experimental)\n");
 	rerr("\n");
+	rerr("  -m MiB             Read the streams through small windows\n");
+	rerr("                     instead of mapping them, using at most\n");
+	rerr("                     the given memory in MiB shared among\n");
+	rerr("                     all streams. For traces larger than\n");
+	rerr("                     the available memory.\n");
+	rerr("\n");
+	rerr("  -j N               Emulate the looms in N worker processes\n");
+	rerr("                     in parallel, merging their output at\n");
+	rerr("                     the end. Cannot be used with -b.\n");
+	rerr("\n");
+	rerr("  -p                 Pipeline the emulation in threads: one\n");
+	rerr("                     reads the streams, one runs the models\n");
+	rerr("                     and one per trace writes its lines.\n");
+	rerr("                     Cannot be used with -m.\n");
+	rerr("\n");
+	rerr("  -g                 Group the events of the same row and\n");
+	rerr("                     time in a single PRV line, instead of\n");
+	rerr("                     writing one line per event.\n");
+	rerr("\n");
+	rerr("  -z                 Write a compact binary log of the PRV\n");
+	rerr("                     lines in .bprv files instead of the\n");
+	rerr("                     .prv files, to be converted later by\n");
+	rerr("                     ovni2prv. Cannot be used with -j.\n");
+	rerr("\n");
+	rerr("  -e                 Also export the traces for Perfetto in\n");
+	rerr("                     .pftrace files, with one track per\n");
+	rerr("                     thread or CPU. Cannot be used with -j.\n");
+	rerr("\n");
+	rerr("  -t                 Also export the changes of each channel\n");
+	rerr("                     as time series in .col files, to be\n");
+	rerr("                     analyzed without parsing the PRV.\n");
+	rerr("                     Cannot be used with -j.\n");
+	rerr("\n");
+	rerr("  -r                 Also write the profile of each channel\n");
+	rerr("                     in .prof files, with the time spent in\n");
+	rerr("                     each value by thread or CPU and a\n");
+	rerr("                     histogram of the durations. Cannot be\n");
+	rerr("                     used with -j.\n");
+	rerr("\n");
+	rerr("  -s size            Split each PRV in shards of the given\n");
+	rerr("                     trace time (10s, 500ms) or size (512M,\n");
+	rerr("                     2G), named <trace>.<n>.prv, which share\n");
+	rerr("                     the PCF and ROW files and can be opened\n");
+	rerr("                     alone. Cannot be used with -j, -p, -z\n");
+	rerr("                     or -n.\n");
+	rerr("\n");
 	rerr("  -l                 Enable linter mode. Extra tests will\n");
 	rerr("                     be performed.\n");
 	rerr("\n");
+	rerr("  -n                 Only run the models, without writing\n");
+	rerr("                     the PRV, PCF and ROW files. Useful to\n");
+	rerr("                     check a trace with -l or to write the\n");
+	rerr("                     exports alone. Cannot be used with -j\n");
+	rerr("                     or -z.\n");
+	rerr("\n");
 	rerr("  -h                 Show help.\n");
 	rerr("\n");
 	rerr("  tracedir           The output trace dir generated by ovni.\n");
@@ -49,17 +101,78 @@ usage(void)
 	exit(EXIT_FAILURE);
 }
 
+static int64_t
+parse_budget(const char *arg)
+{
+	char *end;
+	long long mib = strtoll(arg, &end, 10);
+
+	if (end == arg || *end != '\0' || mib <= 0) {
+		err("invalid memory budget '%s', expected MiB", arg);
+		usage();
+	}
+
+	return (int64_t) mib * 1024LL * 1024LL;
+}
+
+/* Parses the size of the shards as trace time with the s or ms suffix, or
+ * as bytes with the K, M or G suffix */
+static void
+parse_shard(const char *arg, struct emu_args *args)
+{
+	char *end;
+	long long n = strtoll(arg, &end, 10);
+
+	if (end == arg || n <= 0) {
+		err("invalid shard size '%s'", arg);
+		usage();
+	}
+
+	if (strcmp(end, "s") == 0)
+		args->shard_ns = n * 1000000000LL;
+	else if (strcmp(end, "ms") == 0)
+		args->shard_ns = n * 1000000LL;
+	else if (strcmp(end, "K") == 0)
+		args->shard_bytes = n * 1024LL;
+	else if (strcmp(end, "M") == 0)
+		args->shard_bytes = n * 1024LL * 1024LL;
+	else if (strcmp(end, "G") == 0)
+		args->shard_bytes = n * 1024LL * 1024LL * 1024LL;
+	else {
+		err("invalid shard size '%s', expected s, ms, K, M or G suffix", arg);
+		usage();
+	}
+}
+
+static int
+parse_workers(const char *arg)
+{
+	char *end;
+	long n = strtol(arg, &end, 10);
+
+	if (end == arg || *end != '\0' || n <= 0 || n > 4096) {
+		err("invalid number of workers '%s'", arg);
+		usage();
+	}
+
+	return (int) n;
+}
+
 void
 emu_args_init(struct emu_args *args, int argc, char *argv[])
 {
 	memset(args, 0, sizeof(struct emu_args));
+	args->nworkers = 1;
 
 	int opt;
-	while ((opt = getopt(argc, argv, "abdc:lhx:")) != -1) {
+	while ((opt = getopt(argc, argv, "abdc:eglhj:m:nprs:tx:z")) != -1) {
 		switch (opt) {
 			case 'c':
 				args->clock_offset_file = optarg;
 				break;
+			case 'g':
+				args->coalesce = 1;
+				break;
 			case 'l':
 				args->linter_mode = 1;
 				break;
@@ -72,9 +185,36 @@ emu_args_init(struct emu_args *args, int argc, char *argv[])
 			case 'd':
 				enable_debug();
 				break;
+			case 'e':
+				args->perfetto = 1;
+				break;
+			case 'j':
+				args->nworkers = parse_workers(optarg);
+				break;
+			case 'm':
+				args->read_budget = parse_budget(optarg);
+				break;
+			case 'n':
+				args->no_prv = 1;
+				break;
+			case 'p':
+				args->pipeline = 1;
+				break;
+			case 'r':
+				args->profile = 1;
+				break;
+			case 's':
+				parse_shard(optarg, args);
+				break;
+			case 't':
+				args->columns = 1;
+				break;
 			case 'x':
 				args->xtasks_config = optarg;
 				break;
+			case 'z':
+				args->binary = 1;
+				break;
 			case 'h':
 			default: /* '?' */
 				usage();
@@ -86,6 +226,59 @@ emu_args_init(struct emu_args *args, int argc, char *argv[])
 		usage();
 	}
 
+	/* The breakdown model mixes the CPUs of all looms */
+	if (args->breakdown && args->nworkers > 1) {
+		err("the breakdown model cannot be emulated in parallel");
+		usage();
+	}
+
+	/* The window of the stream is reused while events are queued */
+	if (args->pipeline && args->read_budget > 0) {
+		err("the pipeline requires the streams to be mapped");
+		usage();
+	}
+
+	/* The parts of the workers are merged as PRV text */
+	if (args->binary && args->nworkers > 1) {
+		err("the binary log cannot be emulated in parallel");
+		usage();
+	}
+
+	/* The parts of the workers are only merged as PRV */
+	if (args->perfetto && args->nworkers > 1) {
+		err("the Perfetto traces cannot be emulated in parallel");
+		usage();
+	}
+
+	if (args->columns && args->nworkers > 1) {
+		err("the time series cannot be emulated in parallel");
+		usage();
+	}
+
+	if (args->profile && args->nworkers > 1) {
+		err("the profile cannot be emulated in parallel");
+		usage();
+	}
+
+	/* The workers only merge PRV parts */
+	if (args->no_prv && args->nworkers > 1) {
+		err("the PRV cannot be skipped in parallel");
+		usage();
+	}
+
+	if (args->no_prv && args->binary) {
+		err("the binary log requires the PRV");
+		usage();
+	}
+
+	/* Only the PRV files written by the main thread are split */
+	int shard = args->shard_ns > 0 || args->shard_bytes > 0;
+	if (shard && (args->nworkers > 1 || args->pipeline
+				|| args->binary || args->no_prv)) {
+		err("the shards cannot be used with -j, -p, -z or -n");
+		usage();
+	}
+
 	args->tracedir = argv[optind];
 	path_remove_trailing(args->tracedir);
 }
@@ -4,10 +4,23 @@
 #ifndef EMU_ARGS_H
 #define EMU_ARGS_H
 
+#include <stdint.h>
+
 struct emu_args {
 	int linter_mode;
 	int breakdown;
 	int enable_all_models;
+	int64_t read_budget; /* In bytes, zero to map the streams */
+	int nworkers; /* Processes emulating the looms in parallel */
+	int pipeline; /* Decode and write on their own threads */
+	int coalesce; /* One PRV line per row and time */
+	int binary; /* Write .bprv binary logs instead of .prv */
+	int perfetto; /* Also export .pftrace files for Perfetto */
+	int columns; /* Also export .col files with time series */
+	int profile; /* Also write .prof files with the profile */
+	int no_prv; /* Only run the models, without Paraver traces */
+	int64_t shard_ns; /* Split the PRV every ns of trace time */
+	int64_t shard_bytes; /* Or every given bytes */
 	char *clock_offset_file;
 	char *tracedir;
 	char *xtasks_config; // FPGA accelerator information
@@ -6,7 +6,6 @@
 
 #include <inttypes.h>
 #include <stddef.h>
-#include "uthash.h"
 
 struct ev_decl {
 	const char *signature;
@@ -43,8 +42,6 @@ struct ev_spec {
 	struct ev_arg args[MAX_ARGS];
 	size_t payload_size;
 	const char *description;
-
-	UT_hash_handle hh; /* hash map by MCV for model_evspec */
 };
 
 /* Helpers for event pairs (with same with). */
@@ -5,6 +5,7 @@
 #define KERNEL_PRIV_H
 
 #include "emu.h"
+#include "model.h"
 #include "model_cpu.h"
 #include "model_thread.h"
 
@@ -30,7 +31,8 @@ struct kernel_cpu {
 int model_kernel_probe(struct emu *emu);
 int model_kernel_create(struct emu *emu);
 int model_kernel_connect(struct emu *emu);
-int model_kernel_event(struct emu *emu);
 int model_kernel_finish(struct emu *emu);
 
+extern struct model_handler model_kernel_handlers[];
+
 #endif /* KERNEL_PRIV_H */
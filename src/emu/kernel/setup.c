@@ -33,7 +33,7 @@ struct model_spec model_kernel = {
 	.model   = model_id,
 	.create  = model_kernel_create,
 	.connect = model_kernel_connect,
-	.event   = model_kernel_event,
+	.handlers = model_kernel_handlers,
 	.probe   = model_kernel_probe,
 };
 
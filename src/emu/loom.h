@@ -31,6 +31,9 @@ struct loom {
 
 	int64_t clock_offset;
 
+	/* Emulation worker in charge of this loom */
+	int part;
+
 	/* Physical CPUs hash table by phyid */
 	struct cpu *cpus;
 
@@ -174,11 +174,26 @@ model_event(struct model *model, struct emu *emu, int index)
 		return -1;
 	}
 
-	if (spec->event == NULL)
+	if (spec->handlers == NULL)
 		return 0;
 
-	if (spec->event(emu) != 0) {
-		err("event() failed for '%s' model", spec->name);
+	struct emu_ev *ev = emu->ev;
+	const struct model_evspec_entry *entry =
+		model_evspec_get(spec->evspec, ev->c, ev->v);
+
+	if (entry == NULL) {
+		err("unknown event %s for model %s", ev->mcv, spec->name);
+		return -1;
+	}
+
+	if (spec->check != NULL && spec->check(emu) != 0) {
+		err("check() failed for '%s' model", spec->name);
+		return -1;
+	}
+
+	if (entry->handler(emu) != 0) {
+		err("cannot process event %s of '%s' model",
+				ev->mcv, spec->name);
 		return -1;
 	}
 
@@ -11,6 +11,14 @@ struct emu_ev;
 struct ev_decl;
 struct ev_spec;
 
+/* Handler of the events of a category, given by an MCV of two characters
+ * like "6T", or of one event with the full MCV. The handler of one event
+ * takes precedence over the one of its category. */
+struct model_handler {
+	const char *mcv;
+	emu_hook_t *handler;
+};
+
 struct model_spec {
 	const char *name;
 	const char *version;
@@ -19,7 +27,8 @@ struct model_spec {
 	emu_hook_t *probe;
 	emu_hook_t *create;
 	emu_hook_t *connect;
-	emu_hook_t *event;
+	emu_hook_t *check; /* Called before the handler of each event */
+	struct model_handler *handlers; /* Ends with a NULL MCV */
 	emu_hook_t *finish;
 
 	struct model_evspec *evspec;
@@ -4,12 +4,80 @@
 #include "model_evspec.h"
 #include "model.h"
 #include "ev_spec.h"
+#include <stdlib.h>
 #include <string.h>
 
+/* Finds the handler of the event, given by its MCV or by the category */
+static emu_hook_t *
+find_handler(struct model_spec *spec, const char *mcv)
+{
+	if (spec->handlers == NULL)
+		return NULL;
+
+	emu_hook_t *handler = NULL;
+	for (struct model_handler *h = spec->handlers; h->mcv != NULL; h++) {
+		if (strcmp(h->mcv, mcv) == 0)
+			return h->handler;
+
+		if (strlen(h->mcv) == 2 && strncmp(h->mcv, mcv, 2) == 0)
+			handler = h->handler;
+	}
+
+	return handler;
+}
+
+static int
+add_row(struct model_evspec *evspec, struct model_spec *spec, uint8_t c)
+{
+	if (evspec->row[c] != 0)
+		return 0;
+
+	if (evspec->nrows >= 255) {
+		err("too many categories in model %s", spec->name);
+		return -1;
+	}
+
+	evspec->row[c] = (uint8_t) ++evspec->nrows;
+
+	return 0;
+}
+
+/* Fills the values of each category not declared with its handler */
+static int
+add_category_handlers(struct model_evspec *evspec, struct model_spec *spec)
+{
+	if (spec->handlers == NULL)
+		return 0;
+
+	for (struct model_handler *h = spec->handlers; h->mcv != NULL; h++) {
+		size_t len = strlen(h->mcv);
+		if (len == 3 && model_evspec_find(evspec, h->mcv) != NULL)
+			continue;
+
+		if (len != 2 || h->mcv[0] != spec->model) {
+			err("bad handler MCV '%s' for model %s", h->mcv, spec->name);
+			return -1;
+		}
+
+		uint8_t c = (uint8_t) h->mcv[1];
+		if (add_row(evspec, spec, c) != 0)
+			return -1;
+
+		struct model_evspec_entry *row = evspec->table[evspec->row[c] - 1];
+		for (int v = 0; v < 256; v++) {
+			if (row[v].spec == NULL)
+				row[v].handler = h->handler;
+		}
+	}
+
+	return 0;
+}
+
 int
 model_evspec_init(struct model_evspec *evspec, struct model_spec *spec)
 {
 	memset(evspec, 0, sizeof(struct model_evspec));
+	evspec->model = spec->model;
 
 	/* Count events */
 	for (long i = 0; spec->evlist[i].signature != NULL; i++)
@@ -27,6 +95,13 @@ model_evspec_init(struct model_evspec *evspec, struct model_spec *spec)
 		return -1;
 	}
 
+	/* One row for each category, as there are only a few */
+	evspec->table = calloc(256, sizeof(*evspec->table));
+	if (evspec->table == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
 	for (long i = 0; spec->evlist[i].signature != NULL; i++) {
 		struct ev_decl *evdecl = &spec->evlist[i];
 		struct ev_spec *s = &evspec->alloc[i];
@@ -56,17 +131,42 @@ model_evspec_init(struct model_evspec *evspec, struct model_spec *spec)
 			return -1;
 		}
 
+		uint8_t c = (uint8_t) s->mcv[1];
+		if (add_row(evspec, spec, c) != 0)
+			return -1;
+
+		struct model_evspec_entry *entry =
+			&evspec->table[evspec->row[c] - 1][(uint8_t) s->mcv[2]];
+		entry->spec = s;
+		entry->handler = find_handler(spec, s->mcv);
 
-		HASH_ADD_STR(evspec->spec, mcv, s);
+		if (spec->handlers != NULL && entry->handler == NULL) {
+			err("missing handler for event %s in model %s",
+					s->mcv, spec->name);
+			return -1;
+		}
 	}
 
+	if (add_category_handlers(evspec, spec) != 0)
+		return -1;
+
+	/* Release the unused rows */
+	void *table = realloc(evspec->table,
+			(size_t) evspec->nrows * sizeof(*evspec->table));
+	if (table != NULL)
+		evspec->table = table;
+
 	return 0;
 }
 
 struct ev_spec *
-model_evspec_find(struct model_evspec *evspec, char *mcv)
+model_evspec_find(struct model_evspec *evspec, const char *mcv)
 {
-	struct ev_spec *s = NULL;
-	HASH_FIND_STR(evspec->spec, mcv, s);
-	return s;
+	if (mcv[0] != evspec->model || mcv[1] == '\0' || mcv[2] == '\0' || mcv[3] != '\0')
+		return NULL;
+
+	const struct model_evspec_entry *entry =
+		model_evspec_get(evspec, (uint8_t) mcv[1], (uint8_t) mcv[2]);
+
+	return entry != NULL ? entry->spec : NULL;
 }
@@ -4,14 +4,31 @@
 #ifndef MODEL_EVSPEC_H
 #define MODEL_EVSPEC_H
 
+#include <stdint.h>
 #include "common.h"
+#include "emu_hook.h"
 
 struct model_spec;
 struct ev_spec;
 
+/* Declared event with the handler that processes it. The handler of a
+ * category also processes the values that are not declared. */
+struct model_evspec_entry {
+	struct ev_spec *spec; /* NULL if not declared */
+	emu_hook_t *handler;
+};
+
 struct model_evspec {
-	/* Hash table indexed by MCV */
-	struct ev_spec *spec;
+	/* Model character of the MCVs */
+	int model;
+
+	/* Row in table of each category plus one, or zero if the
+	 * category has no events */
+	uint8_t row[256];
+	long nrows;
+
+	/* Entry of each category and value */
+	struct model_evspec_entry (*table)[256];
 	long nevents;
 
 	/* Contiguous memory for allocated table */
@@ -19,6 +36,22 @@ struct model_evspec {
 };
 
 USE_RET int model_evspec_init(struct model_evspec *evspec, struct model_spec *spec);
-USE_RET struct ev_spec *model_evspec_find(struct model_evspec *evspec, char *mcv);
+USE_RET struct ev_spec *model_evspec_find(struct model_evspec *evspec, const char *mcv);
+
+/* Returns the entry of the event with the given category and value, or
+ * NULL if it is not declared nor handled */
+static inline const struct model_evspec_entry *
+model_evspec_get(const struct model_evspec *evspec, uint8_t c, uint8_t v)
+{
+	int row = evspec->row[c];
+	if (row == 0)
+		return NULL;
+
+	const struct model_evspec_entry *entry = &evspec->table[row - 1][v];
+	if (entry->spec == NULL && entry->handler == NULL)
+		return NULL;
+
+	return entry;
+}
 
 #endif /* MODEL_EVSPEC_H */
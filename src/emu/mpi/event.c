@@ -8,13 +8,12 @@
 #include "emu_ev.h"
 #include "extend.h"
 #include "model_thread.h"
+#include "state_table.h"
 #include "thread.h"
 #include "value.h"
 
-enum { PUSH = 1, POP = 2, IGN = 3 };
-
-static const int fn_table[256][256][3] = {
-	['U'] = {
+static const struct state_entry *const fn_table[256] = {
+	['U'] = STATE_ROW {
 		['i'] = { CH_FUNCTION, PUSH, ST_MPI_INIT },
 		['I'] = { CH_FUNCTION, POP,  ST_MPI_INIT },
 		['t'] = { CH_FUNCTION, PUSH, ST_MPI_INIT_THREAD },
@@ -22,7 +21,7 @@ static const int fn_table[256][256][3] = {
 		['f'] = { CH_FUNCTION, PUSH, ST_MPI_FINALIZE },
 		['F'] = { CH_FUNCTION, POP,  ST_MPI_FINALIZE },
 	},
-	['W'] = {
+	['W'] = STATE_ROW {
 		['['] = { CH_FUNCTION, PUSH, ST_MPI_WAIT },
 		[']'] = { CH_FUNCTION, POP,  ST_MPI_WAIT },
 		['a'] = { CH_FUNCTION, PUSH, ST_MPI_WAITALL },
@@ -32,7 +31,7 @@ static const int fn_table[256][256][3] = {
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_WAITSOME },
 		['S'] = { CH_FUNCTION, POP,  ST_MPI_WAITSOME },
 	},
-	['T'] = {
+	['T'] = STATE_ROW {
 		['['] = { CH_FUNCTION, PUSH, ST_MPI_TEST },
 		[']'] = { CH_FUNCTION, POP,  ST_MPI_TEST },
 		['a'] = { CH_FUNCTION, PUSH, ST_MPI_TESTALL },
@@ -42,7 +41,7 @@ static const int fn_table[256][256][3] = {
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_TESTSOME },
 		['S'] = { CH_FUNCTION, POP,  ST_MPI_TESTSOME },
 	},
-	['R'] = {
+	['R'] = STATE_ROW {
 		['['] = { CH_FUNCTION, PUSH, ST_MPI_RECV },
 		[']'] = { CH_FUNCTION, POP,  ST_MPI_RECV },
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_SENDRECV },
@@ -50,7 +49,7 @@ static const int fn_table[256][256][3] = {
 		['o'] = { CH_FUNCTION, PUSH, ST_MPI_SENDRECV_REPLACE },
 		['O'] = { CH_FUNCTION, POP,  ST_MPI_SENDRECV_REPLACE },
 	},
-	['r'] = {
+	['r'] = STATE_ROW {
 		['['] = { CH_FUNCTION, PUSH, ST_MPI_IRECV },
 		[']'] = { CH_FUNCTION, POP,  ST_MPI_IRECV },
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_ISENDRECV },
@@ -58,7 +57,7 @@ static const int fn_table[256][256][3] = {
 		['o'] = { CH_FUNCTION, PUSH, ST_MPI_ISENDRECV_REPLACE },
 		['O'] = { CH_FUNCTION, POP,  ST_MPI_ISENDRECV_REPLACE },
 	},
-	['S'] = {
+	['S'] = STATE_ROW {
 		['['] = { CH_FUNCTION, PUSH, ST_MPI_SEND },
 		[']'] = { CH_FUNCTION, POP,  ST_MPI_SEND },
 		['b'] = { CH_FUNCTION, PUSH, ST_MPI_BSEND },
@@ -68,7 +67,7 @@ static const int fn_table[256][256][3] = {
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_SSEND },
 		['S'] = { CH_FUNCTION, POP,  ST_MPI_SSEND },
 	},
-	['s'] = {
+	['s'] = STATE_ROW {
 		['['] = { CH_FUNCTION, PUSH, ST_MPI_ISEND },
 		[']'] = { CH_FUNCTION, POP,  ST_MPI_ISEND },
 		['b'] = { CH_FUNCTION, PUSH, ST_MPI_IBSEND },
@@ -78,7 +77,7 @@ static const int fn_table[256][256][3] = {
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_ISSEND },
 		['S'] = { CH_FUNCTION, POP,  ST_MPI_ISSEND },
 	},
-	['A'] = {
+	['A'] = STATE_ROW {
 		['g'] = { CH_FUNCTION, PUSH, ST_MPI_ALLGATHER },
 		['G'] = { CH_FUNCTION, POP,  ST_MPI_ALLGATHER },
 		['r'] = { CH_FUNCTION, PUSH, ST_MPI_ALLREDUCE },
@@ -86,7 +85,7 @@ static const int fn_table[256][256][3] = {
 		['a'] = { CH_FUNCTION, PUSH, ST_MPI_ALLTOALL },
 		['A'] = { CH_FUNCTION, POP,  ST_MPI_ALLTOALL },
 	},
-	['a'] = {
+	['a'] = STATE_ROW {
 		['g'] = { CH_FUNCTION, PUSH, ST_MPI_IALLGATHER },
 		['G'] = { CH_FUNCTION, POP,  ST_MPI_IALLGATHER },
 		['r'] = { CH_FUNCTION, PUSH, ST_MPI_IALLREDUCE },
@@ -94,7 +93,7 @@ static const int fn_table[256][256][3] = {
 		['a'] = { CH_FUNCTION, PUSH, ST_MPI_IALLTOALL },
 		['A'] = { CH_FUNCTION, POP,  ST_MPI_IALLTOALL },
 	},
-	['C'] = {
+	['C'] = STATE_ROW {
 		['b'] = { CH_FUNCTION, PUSH, ST_MPI_BARRIER },
 		['B'] = { CH_FUNCTION, POP,  ST_MPI_BARRIER },
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_SCAN },
@@ -102,7 +101,7 @@ static const int fn_table[256][256][3] = {
 		['e'] = { CH_FUNCTION, PUSH, ST_MPI_EXSCAN },
 		['E'] = { CH_FUNCTION, POP,  ST_MPI_EXSCAN },
 	},
-	['c'] = {
+	['c'] = STATE_ROW {
 		['b'] = { CH_FUNCTION, PUSH, ST_MPI_IBARRIER },
 		['B'] = { CH_FUNCTION, POP,  ST_MPI_IBARRIER },
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_ISCAN },
@@ -110,7 +109,7 @@ static const int fn_table[256][256][3] = {
 		['e'] = { CH_FUNCTION, PUSH, ST_MPI_IEXSCAN },
 		['E'] = { CH_FUNCTION, POP,  ST_MPI_IEXSCAN },
 	},
-	['D'] = {
+	['D'] = STATE_ROW {
 		['b'] = { CH_FUNCTION, PUSH, ST_MPI_BCAST },
 		['B'] = { CH_FUNCTION, POP,  ST_MPI_BCAST },
 		['g'] = { CH_FUNCTION, PUSH, ST_MPI_GATHER },
@@ -118,7 +117,7 @@ static const int fn_table[256][256][3] = {
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_SCATTER },
 		['S'] = { CH_FUNCTION, POP,  ST_MPI_SCATTER },
 	},
-	['d'] = {
+	['d'] = STATE_ROW {
 		['b'] = { CH_FUNCTION, PUSH, ST_MPI_IBCAST },
 		['B'] = { CH_FUNCTION, POP,  ST_MPI_IBCAST },
 		['g'] = { CH_FUNCTION, PUSH, ST_MPI_IGATHER },
@@ -126,7 +125,7 @@ static const int fn_table[256][256][3] = {
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_ISCATTER },
 		['S'] = { CH_FUNCTION, POP,  ST_MPI_ISCATTER },
 	},
-	['E'] = {
+	['E'] = STATE_ROW {
 		['['] = { CH_FUNCTION, PUSH, ST_MPI_REDUCE },
 		[']'] = { CH_FUNCTION, POP,  ST_MPI_REDUCE },
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_REDUCE_SCATTER },
@@ -134,7 +133,7 @@ static const int fn_table[256][256][3] = {
 		['b'] = { CH_FUNCTION, PUSH, ST_MPI_REDUCE_SCATTER_BLOCK },
 		['B'] = { CH_FUNCTION, POP,  ST_MPI_REDUCE_SCATTER_BLOCK },
 	},
-	['e'] = {
+	['e'] = STATE_ROW {
 		['['] = { CH_FUNCTION, PUSH, ST_MPI_IREDUCE },
 		[']'] = { CH_FUNCTION, POP,  ST_MPI_IREDUCE },
 		['s'] = { CH_FUNCTION, PUSH, ST_MPI_IREDUCE_SCATTER },
@@ -144,18 +143,25 @@ static const int fn_table[256][256][3] = {
 	},
 };
 
-static int
-process_ev(struct emu *emu)
+int
+model_mpi_check(struct emu *emu)
 {
 	if (!emu->thread->is_running) {
 		err("current thread %d not running", emu->thread->tid);
 		return -1;
 	}
 
-	const int *entry = fn_table[emu->ev->c][emu->ev->v];
-	int chind = entry[0];
-	int action = entry[1];
-	int st = entry[2];
+	return 0;
+}
+
+static int
+simple(struct emu *emu)
+{
+	const struct state_entry *entry = state_table_get(fn_table,
+			emu->ev->c, emu->ev->v);
+	int chind = entry->chan;
+	int action = entry->action;
+	int st = entry->st;
 
 	struct mpi_thread *th = EXT(emu->thread, 'M');
 	struct chan *ch = &th->m.ch[chind];
@@ -172,20 +178,21 @@ process_ev(struct emu *emu)
 	return -1;
 }
 
-int
-model_mpi_event(struct emu *emu)
-{
-	dbg("in mpi_event");
-	if (emu->ev->m != 'M') {
-		err("unexpected event model %c", emu->ev->m);
-		return -1;
-	}
-
-	dbg("got mpi event %s", emu->ev->mcv);
-	if (process_ev(emu) != 0) {
-		err("error processing mpi event");
-		return -1;
-	}
-
-	return 0;
-}
+struct model_handler model_mpi_handlers[] = {
+	{ "MU", simple },
+	{ "MW", simple },
+	{ "MT", simple },
+	{ "MR", simple },
+	{ "Mr", simple },
+	{ "MS", simple },
+	{ "Ms", simple },
+	{ "MA", simple },
+	{ "Ma", simple },
+	{ "MC", simple },
+	{ "Mc", simple },
+	{ "MD", simple },
+	{ "Md", simple },
+	{ "ME", simple },
+	{ "Me", simple },
+	{ NULL, NULL },
+};
@@ -5,6 +5,7 @@
 #define MPI_PRIV_H
 
 #include "emu.h"
+#include "model.h"
 #include "model_cpu.h"
 #include "model_thread.h"
 
@@ -78,7 +79,9 @@ struct mpi_cpu {
 int model_mpi_probe(struct emu *emu);
 int model_mpi_create(struct emu *emu);
 int model_mpi_connect(struct emu *emu);
-int model_mpi_event(struct emu *emu);
+int model_mpi_check(struct emu *emu);
 int model_mpi_finish(struct emu *emu);
 
+extern struct model_handler model_mpi_handlers[];
+
 #endif /* MPI_PRIV_H */
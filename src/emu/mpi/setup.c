@@ -100,7 +100,8 @@ struct model_spec model_mpi = {
 	.model   = model_id,
 	.create  = model_mpi_create,
 	.connect = model_mpi_connect,
-	.event   = model_mpi_event,
+	.check   = model_mpi_check,
+	.handlers = model_mpi_handlers,
 	.probe   = model_mpi_probe,
 	.finish  = model_mpi_finish,
 };
@@ -54,49 +54,103 @@ select_input(struct mux *mux,
 	return 0;
 }
 
-/** Called when the select channel changes its value */
+/* Starts notifying the mux of the input when its channel changes */
 static int
-cb_select(struct chan *sel_chan, void *ptr)
+watch(struct mux_input *input)
 {
-	struct mux *mux = ptr;
+	struct mux_watch *w = input->watch;
+
+	if (w->n >= w->max) {
+		long n = w->max == 0 ? 2 : w->max * 2;
+		struct mux_input **inputs = realloc(w->inputs,
+				(size_t) n * sizeof(struct mux_input *));
+		if (inputs == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		w->inputs = inputs;
+		w->max = n;
+	}
 
-	dbg("selecting input for output chan chan=%s", mux->output->name);
+	w->inputs[w->n++] = input;
 
-	struct value sel_value;
-	if (chan_read(sel_chan, &sel_value) != 0) {
-		err("chan_read(select) failed");
-		return -1;
-	}
+	return 0;
+}
 
-	/* Clear previous selected input */
-	if (mux->selected >= 0) {
-		struct mux_input *old_input = &mux->inputs[mux->selected];
-		bay_disable_cb(old_input->cb);
-		old_input->selected = 0;
-		mux->selected = -1;
+static void
+unwatch(struct mux_input *input)
+{
+	struct mux_watch *w = input->watch;
+
+	/* Keep the order of the rest, so the muxes are notified in
+	 * the order they selected the channel */
+	for (long i = 0; i < w->n; i++) {
+		if (w->inputs[i] != input)
+			continue;
+
+		memmove(&w->inputs[i], &w->inputs[i + 1],
+				(size_t) (w->n - i - 1) * sizeof(struct mux_input *));
+		w->n--;
+		return;
 	}
 
-	dbg("select channel got value %s",
-			value_str(sel_value));
+	die("selected mux input not found in watch of %s", input->chan->name);
+}
 
-	struct mux_input *input = NULL;
-	if (select_input(mux, sel_value, &input) != 0) {
-		err("select_input failed");
-		return -1;
-	}
+/** Selects the input again if needed and updates the output, once the
+ * select and input channels of this propagation are updated */
+static int
+mux_eval(void *arg)
+{
+	struct mux *mux = arg;
+
+	if (mux->reselect) {
+		mux->reselect = 0;
 
-	if (input) {
-		bay_enable_cb(input->cb);
-		input->selected = 1;
-		mux->selected = input->index;
-		dbg("mux selects input key=%s chan=%s",
-				value_str(sel_value), input->chan->name);
+		dbg("selecting input for output chan chan=%s", mux->output->name);
+
+		struct value sel_value;
+		if (chan_read(mux->select, &sel_value) != 0) {
+			err("chan_read(select) failed");
+			return -1;
+		}
+
+		/* Clear previous selected input */
+		if (mux->selected >= 0) {
+			struct mux_input *old_input = &mux->inputs[mux->selected];
+			unwatch(old_input);
+			old_input->selected = 0;
+			mux->selected = -1;
+		}
+
+		dbg("select channel got value %s",
+				value_str(sel_value));
+
+		struct mux_input *input = NULL;
+		if (select_input(mux, sel_value, &input) != 0) {
+			err("select_input failed");
+			return -1;
+		}
+
+		if (input) {
+			if (watch(input) != 0) {
+				err("watch failed");
+				return -1;
+			}
+			input->selected = 1;
+			mux->selected = input->index;
+			dbg("mux selects input key=%s chan=%s",
+					value_str(sel_value), input->chan->name);
+		}
 	}
 
 	struct value out_value = mux->def;
-	if (input != NULL && chan_read(input->chan, &out_value) != 0) {
-		err("chan_read() failed");
-		return -1;
+	if (mux->selected >= 0) {
+		struct mux_input *input = &mux->inputs[mux->selected];
+		if (chan_read(input->chan, &out_value) != 0) {
+			err("chan_read() failed");
+			return -1;
+		}
 	}
 
 	dbg("setting output chan %s to %s",
@@ -110,30 +164,63 @@ cb_select(struct chan *sel_chan, void *ptr)
 	return 0;
 }
 
-/** Called when the input channel changes its value and is selected */
+/** Called when the select channel changes its value */
+static int
+cb_select(struct chan *sel_chan, void *ptr)
+{
+	UNUSED(sel_chan);
+	struct mux *mux = ptr;
+
+	mux->reselect = 1;
+
+	return bay_defer(mux->bay, &mux->task);
+}
+
+/** Called when an input channel changes its value, notifying only the
+ * muxes that have it selected */
 static int
 cb_input(struct chan *in_chan, void *ptr)
 {
-	struct mux_input *input = ptr;
+	struct mux_watch *w = ptr;
 
-	dbg("selected mux input %s changed", in_chan->name);
+	dbg("mux input %s changed", in_chan->name);
 
-	struct value out_value;
+	for (long i = 0; i < w->n; i++) {
+		struct mux *mux = w->inputs[i]->mux;
 
-	if (chan_read(in_chan, &out_value) != 0) {
-		err("chan_read() failed");
-		return -1;
+		if (bay_defer(mux->bay, &mux->task) != 0) {
+			err("bay_defer failed");
+			return -1;
+		}
 	}
 
-	dbg("setting output chan %s to value %s",
-			input->output->name, value_str(out_value));
+	return 0;
+}
 
-	if (chan_set(input->output, out_value) != 0) {
-		err("chan_set() failed");
-		return -1;
+/* Returns the watch of the input channel, creating it with the channel
+ * callback the first time the channel is used as input */
+static struct mux_watch *
+get_watch(struct bay *bay, struct chan *chan)
+{
+	struct bay_cb *cb = bay_find_cb(bay, BAY_CB_DIRTY, chan, cb_input);
+	if (cb != NULL)
+		return cb->arg;
+
+	struct mux_watch *w = calloc(1, sizeof(struct mux_watch));
+	if (w == NULL) {
+		err("calloc failed:");
+		return NULL;
 	}
 
-	return 0;
+	w->chan = chan;
+
+	if (bay_add_cb(bay, BAY_CB_DIRTY, chan, cb_input, w, 1) == NULL) {
+		err("bay_add_cb failed");
+		free(w);
+		return NULL;
+	}
+
+	return w;
 }
 
 int
@@ -177,6 +264,7 @@ mux_init(struct mux *mux,
 	mux->select = select;
 	mux->output = output;
 	mux->ninputs = ninputs;
+	mux->selected = -1;
 	mux->inputs = calloc((size_t) ninputs, sizeof(struct mux_input));
 	mux->def = value_null();
 
@@ -188,6 +276,23 @@ mux_init(struct mux *mux,
 	mux->select_func = select_func;
 	mux->bay = bay;
 
+	/* The output is only updated once per propagation, after the select
+	 * and inputs */
+	if (bay_add_task(bay, &mux->task, mux_eval, mux) != 0) {
+		err("bay_add_task failed");
+		return -1;
+	}
+
+	if (bay_task_input(bay, &mux->task, select) != 0) {
+		err("bay_task_input failed");
+		return -1;
+	}
+
+	if (bay_task_output(bay, &mux->task, output) != 0) {
+		err("bay_task_output failed");
+		return -1;
+	}
+
 	/* Select always enabled */
 	if (bay_add_cb(bay, BAY_CB_DIRTY, select, cb_select, mux, 1) == NULL) {
 		err("bay_add_cb failed");
@@ -221,11 +326,18 @@ mux_set_input(struct mux *mux, int64_t index, struct chan *chan)
 	input->index = index;
 	input->chan = chan;
 	input->output = mux->output;
+	input->mux = mux;
 
-	/* Inputs disabled until selected */
-	input->cb = bay_add_cb(mux->bay, BAY_CB_DIRTY, chan, cb_input, input, 0);
-	if (input->cb == NULL) {
-		err("bay_add_cb failed");
+	if (bay_task_input(mux->bay, &mux->task, chan) != 0) {
+		err("bay_task_input failed");
+		return -1;
+	}
+
+	/* Shared by all the muxes with this input, which are only
+	 * notified while they select it */
+	input->watch = get_watch(mux->bay, chan);
+	if (input->watch == NULL) {
+		err("get_watch failed");
 		return -1;
 	}
 
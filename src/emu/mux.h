@@ -5,18 +5,32 @@
 #define MUX_H
 
 #include <stdint.h>
+#include "bay.h"
 #include "common.h"
 #include "value.h"
 struct bay;
 struct chan;
 struct mux;
 
+struct mux_input;
+
+/* Inputs of all the muxes that currently select the same channel. Each
+ * input channel has a single callback that only notifies these muxes, so
+ * changing the selection doesn't modify the bay callbacks. */
+struct mux_watch {
+	struct chan *chan;
+	long n;
+	long max;
+	struct mux_input **inputs;
+};
+
 struct mux_input {
 	int64_t index;
 	struct chan *chan;
 	int selected;
 	struct chan *output;
-	struct bay_cb *cb;
+	struct mux_watch *watch;
+	struct mux *mux;
 };
 
 typedef int (* mux_select_func_t)(struct mux *mux,
@@ -32,6 +46,8 @@ struct mux {
 	struct chan *select;
 	struct chan *output;
 	struct value def;
+	struct bay_task task;
+	int reselect;
 };
 
 void mux_input_init(struct mux_input *mux,
@@ -12,17 +12,16 @@
 #include "model_thread.h"
 #include "ovni.h"
 #include "proc.h"
+#include "state_table.h"
 #include "task.h"
 #include "thread.h"
 #include "value.h"
 
-enum { PUSH = 1, POP, SET, IGN };
-
 #define CHSS CH_SUBSYSTEM
 #define CHTH CH_THREAD
 
-static const int ss_table[256][256][3] = {
-	['W'] = {
+static const struct state_entry *const ss_table[256] = {
+	['W'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_WORKER_LOOP },
 		[']'] = { CHSS, POP,  ST_WORKER_LOOP },
 		['t'] = { CHSS, PUSH, ST_HANDLING_TASK },
@@ -39,44 +38,44 @@ static const int ss_table[256][256][3] = {
 		['G'] = { CHSS, POP,  ST_SPONGE },
 		['*'] = { CHSS, IGN,  -1 },
 	},
-	['P'] = {
+	['P'] = STATE_ROW {
 		['p'] = { CH_IDLE, SET, ST_PROGRESSING },
 		['r'] = { CH_IDLE, SET, ST_RESTING },
 		['a'] = { CH_IDLE, SET, ST_ABSORBING },
 	},
-	['C'] = {
+	['C'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_TASK_CREATING },
 		[']'] = { CHSS, POP,  ST_TASK_CREATING },
 	},
-	['U'] = {
+	['U'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_TASK_SUBMIT },
 		[']'] = { CHSS, POP,  ST_TASK_SUBMIT },
 	},
-	['F'] = {
+	['F'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_TASK_SPAWNING },
 		[']'] = { CHSS, POP,  ST_TASK_SPAWNING },
 	},
-	['O'] = {
+	['O'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_TASK_FOR },
 		[']'] = { CHSS, POP,  ST_TASK_FOR },
 	},
-	['t'] = {
+	['t'] = STATE_ROW {
 		['['] = { CHSS, IGN, -1 },
 		[']'] = { CHSS, IGN, -1 },
 	},
-	['M'] = {
+	['M'] = STATE_ROW {
 		['a'] = { CHSS, PUSH, ST_ALLOCATING },
 		['A'] = { CHSS, POP,  ST_ALLOCATING },
 		['f'] = { CHSS, PUSH, ST_FREEING },
 		['F'] = { CHSS, POP,  ST_FREEING },
 	},
-	['D'] = {
+	['D'] = STATE_ROW {
 		['r'] = { CHSS, PUSH, ST_DEP_REG },
 		['R'] = { CHSS, POP,  ST_DEP_REG },
 		['u'] = { CHSS, PUSH, ST_DEP_UNREG },
 		['U'] = { CHSS, POP,  ST_DEP_UNREG },
 	},
-	['S'] = {
+	['S'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_SCHED_SERVING },
 		[']'] = { CHSS, POP,  ST_SCHED_SERVING },
 		['a'] = { CHSS, PUSH, ST_SCHED_ADDING },
@@ -87,7 +86,7 @@ static const int ss_table[256][256][3] = {
 		['r'] = { CHSS, IGN,  -1 },
 		['s'] = { CHSS, IGN,  -1 },
 	},
-	['B'] = {
+	['B'] = STATE_ROW {
 		['b'] = { CHSS, PUSH, ST_BLK_BLOCKING },
 		['B'] = { CHSS, POP,  ST_BLK_BLOCKING },
 		['u'] = { CHSS, PUSH, ST_BLK_UNBLOCKING },
@@ -97,7 +96,7 @@ static const int ss_table[256][256][3] = {
 		['f'] = { CHSS, PUSH, ST_BLK_WAITFOR },
 		['F'] = { CHSS, POP,  ST_BLK_WAITFOR },
 	},
-	['H'] = {
+	['H'] = STATE_ROW {
 		['e'] = { CHTH, PUSH, ST_TH_EXTERNAL },
 		['E'] = { CHTH, POP,  ST_TH_EXTERNAL },
 		['w'] = { CHTH, PUSH, ST_TH_WORKER },
@@ -112,10 +111,11 @@ static const int ss_table[256][256][3] = {
 static int
 simple(struct emu *emu)
 {
-	const int *entry = ss_table[emu->ev->c][emu->ev->v];
-	int chind = entry[0];
-	int action = entry[1];
-	int st = entry[2];
+	const struct state_entry *entry = state_table_get(ss_table,
+			emu->ev->c, emu->ev->v);
+	int chind = entry->chan;
+	int action = entry->action;
+	int st = entry->st;
 
 	struct nanos6_thread *th = EXT(emu->thread, '6');
 	struct chan *ch = &th->m.ch[chind];
@@ -475,46 +475,9 @@ create_task(struct emu *emu)
 	return 0;
 }
 
-static int
-pre_task(struct emu *emu)
-{
-	int ret = 0;
-	switch (emu->ev->v) {
-		case 'C':
-			warn("got old 6TC event, ignoring");
-			break;
-		case 'c':
-			ret = create_task(emu);
-			break;
-		case 'x':
-		case 'e':
-		case 'r':
-		case 'p':
-			ret = update_task(emu);
-			break;
-		default:
-			err("unexpected Nanos6 task event value");
-			return -1;
-	}
-
-	if (ret != 0) {
-		err("cannot update task state");
-		return -1;
-	}
-
-	return 0;
-}
-
 static int
 pre_type(struct emu *emu)
 {
-	uint8_t value = emu->ev->v;
-
-	if (value != 'c') {
-		err("unexpected event value %c", value);
-		return -1;
-	}
-
 	if (!emu->ev->is_jumbo) {
 		err("expecting a jumbo event");
 		return -1;
@@ -538,54 +501,49 @@ pre_type(struct emu *emu)
 	return 0;
 }
 
+/* Task events not declared */
 static int
-process_ev(struct emu *emu)
+old_task(struct emu *emu)
 {
-	if (!emu->thread->is_active) {
-		err("current thread %d not active", emu->thread->tid);
+	if (emu->ev->v != 'C') {
+		err("unexpected Nanos6 task event value");
 		return -1;
 	}
 
-	switch (emu->ev->c) {
-		case 'C':
-		case 'S':
-		case 'U':
-		case 'F':
-		case 'O':
-		case 't':
-		case 'H':
-		case 'D':
-		case 'B':
-		case 'W':
-		case 'M':
-		case 'P':
-			return simple(emu);
-		case 'T':
-			return pre_task(emu);
-		case 'Y':
-			return pre_type(emu);
-		default:
-			err("unknown Nanos6 event category");
-			return -1;
-	}
-
-	/* Not reached */
+	warn("got old 6TC event, ignoring");
 	return 0;
 }
 
 int
-model_nanos6_event(struct emu *emu)
+model_nanos6_check(struct emu *emu)
 {
-	if (emu->ev->m != '6') {
-		err("unexpected event model %c", emu->ev->m);
-		return -1;
-	}
-
-	dbg("got nanos6 event %s", emu->ev->mcv);
-	if (process_ev(emu) != 0) {
-		err("error processing Nanos6 event");
+	if (!emu->thread->is_active) {
+		err("current thread %d not active", emu->thread->tid);
 		return -1;
 	}
 
 	return 0;
 }
+
+struct model_handler model_nanos6_handlers[] = {
+	{ "6C", simple },
+	{ "6S", simple },
+	{ "6U", simple },
+	{ "6F", simple },
+	{ "6O", simple },
+	{ "6t", simple },
+	{ "6H", simple },
+	{ "6D", simple },
+	{ "6B", simple },
+	{ "6W", simple },
+	{ "6M", simple },
+	{ "6P", simple },
+	{ "6T", old_task },
+	{ "6Tc", create_task },
+	{ "6Tx", update_task },
+	{ "6Te", update_task },
+	{ "6Tr", update_task },
+	{ "6Tp", update_task },
+	{ "6Yc", pre_type },
+	{ NULL, NULL },
+};
@@ -5,6 +5,7 @@
 #define NANOS6_PRIV_H
 
 #include "emu.h"
+#include "model.h"
 #include "task.h"
 #include "sort.h"
 #include "model_cpu.h"
@@ -95,9 +96,11 @@ struct nanos6_emu {
 int model_nanos6_probe(struct emu *emu);
 int model_nanos6_create(struct emu *emu);
 int model_nanos6_connect(struct emu *emu);
-int model_nanos6_event(struct emu *emu);
+int model_nanos6_check(struct emu *emu);
 int model_nanos6_finish(struct emu *emu);
 
+extern struct model_handler model_nanos6_handlers[];
+
 int model_nanos6_breakdown_create(struct emu *emu);
 int model_nanos6_breakdown_connect(struct emu *emu);
 int model_nanos6_breakdown_finish(struct emu *emu,
@@ -85,7 +85,8 @@ struct model_spec model_nanos6 = {
 	.model   = model_id,
 	.create  = model_nanos6_create,
 	.connect = model_nanos6_connect,
-	.event   = model_nanos6_event,
+	.check   = model_nanos6_check,
+	.handlers = model_nanos6_handlers,
 	.probe   = model_nanos6_probe,
 	.finish  = model_nanos6_finish,
 };
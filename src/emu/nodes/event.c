@@ -8,43 +8,42 @@
 #include "emu_ev.h"
 #include "extend.h"
 #include "model_thread.h"
+#include "state_table.h"
 #include "thread.h"
 #include "value.h"
 
-enum { PUSH = 1, POP = 2, IGN = 3 };
-
 #define CHSS CH_SUBSYSTEM
 
-static const int ss_table[256][256][3] = {
-	['R'] = {
+static const struct state_entry *const ss_table[256] = {
+	['R'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_REGISTER },
 		[']'] = { CHSS, POP,  ST_REGISTER },
 	},
-	['U'] = {
+	['U'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_UNREGISTER },
 		[']'] = { CHSS, POP,  ST_UNREGISTER },
 	},
-	['W'] = {
+	['W'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_IF0_WAIT },
 		[']'] = { CHSS, POP,  ST_IF0_WAIT },
 	},
-	['I'] = {
+	['I'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_IF0_INLINE },
 		[']'] = { CHSS, POP,  ST_IF0_INLINE },
 	},
-	['T'] = {
+	['T'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_TASKWAIT },
 		[']'] = { CHSS, POP,  ST_TASKWAIT },
 	},
-	['C'] = {
+	['C'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_CREATE },
 		[']'] = { CHSS, POP,  ST_CREATE },
 	},
-	['S'] = {
+	['S'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_SUBMIT },
 		[']'] = { CHSS, POP,  ST_SUBMIT },
 	},
-	['P'] = {
+	['P'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_SPAWN },
 		[']'] = { CHSS, POP,  ST_SPAWN },
 	},
@@ -53,10 +52,11 @@ static const int ss_table[256][256][3] = {
 static int
 simple(struct emu *emu)
 {
-	const int *entry = ss_table[emu->ev->c][emu->ev->v];
-	int chind = entry[0];
-	int action = entry[1];
-	int st = entry[2];
+	const struct state_entry *entry = state_table_get(ss_table,
+			emu->ev->c, emu->ev->v);
+	int chind = entry->chan;
+	int action = entry->action;
+	int st = entry->st;
 
 	struct nodes_thread *th = EXT(emu->thread, 'D');
 	struct chan *ch = &th->m.ch[chind];
@@ -75,47 +75,25 @@ simple(struct emu *emu)
 	return 0;
 }
 
-static int
-process_ev(struct emu *emu)
+int
+model_nodes_check(struct emu *emu)
 {
 	if (!emu->thread->is_running) {
 		err("current thread %d not running", emu->thread->tid);
 		return -1;
 	}
 
-	switch (emu->ev->c) {
-		case 'R':
-		case 'U':
-		case 'W':
-		case 'I':
-		case 'T':
-		case 'C':
-		case 'S':
-		case 'P':
-			return simple(emu);
-		default:
-			err("unknown NODES event category");
-			return -1;
-	}
-
-	/* Not reached */
 	return 0;
 }
 
-int
-model_nodes_event(struct emu *emu)
-{
-	dbg("in nodes_event");
-	if (emu->ev->m != 'D') {
-		err("unexpected event model %c", emu->ev->m);
-		return -1;
-	}
-
-	dbg("got nodes event %s", emu->ev->mcv);
-	if (process_ev(emu) != 0) {
-		err("error processing NODES event");
-		return -1;
-	}
-
-	return 0;
-}
+struct model_handler model_nodes_handlers[] = {
+	{ "DR", simple },
+	{ "DU", simple },
+	{ "DW", simple },
+	{ "DI", simple },
+	{ "DT", simple },
+	{ "DC", simple },
+	{ "DS", simple },
+	{ "DP", simple },
+	{ NULL, NULL },
+};
@@ -5,6 +5,7 @@
 #define NODES_PRIV_H
 
 #include "emu.h"
+#include "model.h"
 #include "model_cpu.h"
 #include "model_thread.h"
 
@@ -37,7 +38,9 @@ struct nodes_cpu {
 int model_nodes_probe(struct emu *emu);
 int model_nodes_create(struct emu *emu);
 int model_nodes_connect(struct emu *emu);
-int model_nodes_event(struct emu *emu);
+int model_nodes_check(struct emu *emu);
 int model_nodes_finish(struct emu *emu);
 
+extern struct model_handler model_nodes_handlers[];
+
 #endif /* NODES_PRIV_H */
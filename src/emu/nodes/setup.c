@@ -44,7 +44,8 @@ struct model_spec model_nodes = {
 	.model   = model_id,
 	.create  = model_nodes_create,
 	.connect = model_nodes_connect,
-	.event   = model_nodes_event,
+	.check   = model_nodes_check,
+	.handlers = model_nodes_handlers,
 	.probe   = model_nodes_probe,
 	.finish  = model_nodes_finish,
 };
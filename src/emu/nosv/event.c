@@ -12,16 +12,15 @@
 #include "model_thread.h"
 #include "ovni.h"
 #include "proc.h"
+#include "state_table.h"
 #include "task.h"
 #include "thread.h"
 #include "value.h"
 
-enum { PUSH = 1, POP = 2, SET = 3, IGN = 4 };
-
 #define CHSS CH_SUBSYSTEM
 
-static const int ss_table[256][256][3] = {
-	['S'] = {
+static const struct state_entry *const ss_table[256] = {
+	['S'] = STATE_ROW {
 		['h'] = { CHSS, PUSH, ST_SCHED_HUNGRY },
 		['f'] = { CHSS, POP,  ST_SCHED_HUNGRY },
 		['['] = { CHSS, PUSH, ST_SCHED_SERVING },
@@ -32,17 +31,17 @@ static const int ss_table[256][256][3] = {
 		['r'] = { CHSS, IGN,  -1 },
 		['s'] = { CHSS, IGN,  -1 },
 	},
-	['U'] = {
+	['U'] = STATE_ROW {
 		['['] = { CHSS, PUSH, ST_SCHED_SUBMITTING },
 		[']'] = { CHSS, POP,  ST_SCHED_SUBMITTING },
 	},
-	['M'] = {
+	['M'] = STATE_ROW {
 		['a'] = { CHSS, PUSH, ST_MEM_ALLOCATING },
 		['A'] = { CHSS, POP,  ST_MEM_ALLOCATING },
 		['f'] = { CHSS, PUSH, ST_MEM_FREEING },
 		['F'] = { CHSS, POP,  ST_MEM_FREEING },
 	},
-	['A'] = {
+	['A'] = STATE_ROW {
 		['r'] = { CHSS, PUSH, ST_API_CREATE },
 		['R'] = { CHSS, POP, ST_API_CREATE },
 		['d'] = { CHSS, PUSH, ST_API_DESTROY },
@@ -77,7 +76,7 @@ static const int ss_table[256][256][3] = {
 		['K'] = { CHSS, POP,  ST_API_COND_BCAST },
 	},
 	/* FIXME: Move thread type to another channel, like nanos6 */
-	['H'] = {
+	['H'] = STATE_ROW {
 		['a'] = { CHSS, IGN,  0 },
 		['A'] = { CHSS, IGN,  0 },
 		['w'] = { CHSS, PUSH, ST_WORKER },
@@ -85,7 +84,7 @@ static const int ss_table[256][256][3] = {
 		['d'] = { CHSS, PUSH, ST_DELEGATE },
 		['D'] = { CHSS, POP,  ST_DELEGATE },
 	},
-	['P'] = {
+	['P'] = STATE_ROW {
 		['p'] = { CH_IDLE, SET, ST_PROGRESSING },
 		['r'] = { CH_IDLE, SET, ST_RESTING },
 		['a'] = { CH_IDLE, SET, ST_ABSORBING },
@@ -95,10 +94,11 @@ static const int ss_table[256][256][3] = {
 static int
 simple(struct emu *emu)
 {
-	const int *entry = ss_table[emu->ev->c][emu->ev->v];
-	int chind = entry[0];
-	int action = entry[1];
-	int st = entry[2];
+	const struct state_entry *entry = state_table_get(ss_table,
+			emu->ev->c, emu->ev->v);
+	int chind = entry->chan;
+	int action = entry->action;
+	int st = entry->st;
 
 	struct nosv_thread *th = EXT(emu->thread, 'V');
 	struct chan *ch = &th->m.ch[chind];
@@ -477,7 +477,7 @@ update_task(struct emu *emu)
 }
 
 static int
-create_task(struct emu *emu, char value)
+create_task(struct emu *emu, uint32_t flags)
 {
 	if (emu->ev->payload_size < 8) {
 		err("unexpected payload size");
@@ -487,16 +487,6 @@ create_task(struct emu *emu, char value)
 	uint32_t task_id = emu->ev->payload->u32[0];
 	uint32_t type_id = emu->ev->payload->u32[1];
 
-	int is_parallel = (value == 'C');
-
-	uint32_t flags;
-
-	/* Parallel tasks cannot pause or resurrect */
-	if (is_parallel)
-		flags = TASK_FLAG_PARALLEL;
-	else
-		flags = TASK_FLAG_RESURRECT | TASK_FLAG_PAUSE;
-
 	struct nosv_proc *proc = EXT(emu->proc, 'V');
 	struct task_info *info = &proc->task_info;
 
@@ -511,43 +501,21 @@ create_task(struct emu *emu, char value)
 }
 
 static int
-pre_task(struct emu *emu)
+create_single(struct emu *emu)
 {
-	int ret = 0;
-	switch (emu->ev->v) {
-		case 'C':
-		case 'c':
-			ret = create_task(emu, (char) emu->ev->v);
-			break;
-		case 'x':
-		case 'e':
-		case 'r':
-		case 'p':
-			ret = update_task(emu);
-			break;
-		default:
-			err("unexpected nOS-V task event value");
-			return -1;
-	}
-
-	if (ret != 0) {
-		err("cannot update task state");
-		return -1;
-	}
+	return create_task(emu, TASK_FLAG_RESURRECT | TASK_FLAG_PAUSE);
+}
 
-	return 0;
+/* Parallel tasks cannot pause or resurrect */
+static int
+create_parallel(struct emu *emu)
+{
+	return create_task(emu, TASK_FLAG_PARALLEL);
 }
 
 static int
 pre_type(struct emu *emu)
 {
-	uint8_t value = emu->ev->v;
-
-	if (value != 'c') {
-		err("unexpected event value %c", value);
-		return -1;
-	}
-
 	if (!emu->ev->is_jumbo) {
 		err("expecting a jumbo event");
 		return -1;
@@ -571,8 +539,8 @@ pre_type(struct emu *emu)
 	return 0;
 }
 
-static int
-process_ev(struct emu *emu)
+int
+model_nosv_check(struct emu *emu)
 {
 	if (!emu->thread->is_active) {
 		err("current thread %d not active", emu->thread->tid);
@@ -584,43 +552,23 @@ process_ev(struct emu *emu)
 		return -1;
 	}
 
-	switch (emu->ev->c) {
-		case 'S':
-		case 'U':
-		case 'M':
-		case 'H':
-		case 'A':
-		case 'P':
-			return simple(emu);
-		case 'T':
-			return pre_task(emu);
-		case 'Y':
-			return pre_type(emu);
-		case 'W':
-			return hwc_event(emu);
-		default:
-			err("unknown nOS-V event category");
-			return -1;
-	}
-
-	/* Not reached */
 	return 0;
 }
 
-int
-model_nosv_event(struct emu *emu)
-{
-	dbg("in nosv_event");
-	if (emu->ev->m != 'V') {
-		err("unexpected event model %c", emu->ev->m);
-		return -1;
-	}
-
-	dbg("got nosv event %s", emu->ev->mcv);
-	if (process_ev(emu) != 0) {
-		err("error processing nOS-V event");
-		return -1;
-	}
-
-	return 0;
-}
+struct model_handler model_nosv_handlers[] = {
+	{ "VS", simple },
+	{ "VU", simple },
+	{ "VM", simple },
+	{ "VH", simple },
+	{ "VA", simple },
+	{ "VP", simple },
+	{ "VTc", create_single },
+	{ "VTC", create_parallel },
+	{ "VTx", update_task },
+	{ "VTe", update_task },
+	{ "VTr", update_task },
+	{ "VTp", update_task },
+	{ "VYc", pre_type },
+	{ "VWC", hwc_event },
+	{ NULL, NULL },
+};
@@ -470,15 +470,7 @@ hwc_event(struct emu *emu)
 		return -1;
 	}
 
-	switch (emu->ev->v) {
-		case 'C':
-			return event_hwc_count(emu);
-		default:
-			err("unknown nosv hwc event %s", emu->ev->mcv);
-			return -1;
-	}
-
-	return 0;
+	return event_hwc_count(emu);
 }
 
 static int
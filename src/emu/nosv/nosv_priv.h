@@ -6,6 +6,7 @@
 
 #include "breakdown.h"
 #include "emu.h"
+#include "model.h"
 #include "hwc.h"
 #include "model_cpu.h"
 #include "model_thread.h"
@@ -89,9 +90,11 @@ enum nosv_progress {
 int model_nosv_probe(struct emu *emu);
 int model_nosv_create(struct emu *emu);
 int model_nosv_connect(struct emu *emu);
-int model_nosv_event(struct emu *emu);
+int model_nosv_check(struct emu *emu);
 int model_nosv_finish(struct emu *emu);
 
+extern struct model_handler model_nosv_handlers[];
+
 int model_nosv_breakdown_create(struct emu *emu);
 int model_nosv_breakdown_connect(struct emu *emu);
 int model_nosv_breakdown_finish(struct emu *emu,
@@ -95,7 +95,8 @@ struct model_spec model_nosv = {
 	.model   = model_id,
 	.create  = model_nosv_create,
 	.connect = model_nosv_connect,
-	.event   = model_nosv_event,
+	.check   = model_nosv_check,
+	.handlers = model_nosv_handlers,
 	.probe   = model_nosv_probe,
 	.finish  = model_nosv_finish,
 };
@@ -10,14 +10,13 @@
 #include "model_thread.h"
 #include "ovni.h"
 #include "proc.h"
+#include "state_table.h"
 #include "task.h"
 #include "thread.h"
 #include "value.h"
 
-enum { PUSH = 1, POP = 2, IGN = 3 };
-
-static const int fn_table[256][256][3] = {
-	['B'] = {
+static const struct state_entry *const fn_table[256] = {
+	['B'] = STATE_ROW {
 		['b'] = { CH_SUBSYSTEM, PUSH, ST_BARRIER_PLAIN },
 		['B'] = { CH_SUBSYSTEM, POP,  ST_BARRIER_PLAIN },
 		['j'] = { CH_SUBSYSTEM, PUSH, ST_BARRIER_JOIN },
@@ -29,7 +28,7 @@ static const int fn_table[256][256][3] = {
 		['s'] = { CH_SUBSYSTEM, IGN,  ST_BARRIER_SPIN_WAIT },
 		['S'] = { CH_SUBSYSTEM, IGN,  ST_BARRIER_SPIN_WAIT },
 	},
-	['I'] = {
+	['I'] = STATE_ROW {
 		['a'] = { CH_SUBSYSTEM, PUSH, ST_CRITICAL_ACQ },
 		['A'] = { CH_SUBSYSTEM, POP,  ST_CRITICAL_ACQ },
 		['r'] = { CH_SUBSYSTEM, PUSH, ST_CRITICAL_REL },
@@ -37,7 +36,7 @@ static const int fn_table[256][256][3] = {
 		['['] = { CH_SUBSYSTEM, PUSH, ST_CRITICAL_SECTION },
 		[']'] = { CH_SUBSYSTEM, POP,  ST_CRITICAL_SECTION },
 	},
-	['W'] = {
+	['W'] = STATE_ROW {
 		['d'] = { CH_SUBSYSTEM, PUSH, ST_WD_DISTRIBUTE },
 		['D'] = { CH_SUBSYSTEM, POP,  ST_WD_DISTRIBUTE },
 		['c'] = { CH_SUBSYSTEM, PUSH, ST_WD_FOR_DYNAMIC_CHUNK },
@@ -51,7 +50,7 @@ static const int fn_table[256][256][3] = {
 		['i'] = { CH_SUBSYSTEM, PUSH, ST_WD_SINGLE },
 		['I'] = { CH_SUBSYSTEM, POP,  ST_WD_SINGLE },
 	},
-	['T'] = {
+	['T'] = STATE_ROW {
 		['a'] = { CH_SUBSYSTEM, PUSH, ST_TASK_ALLOC },
 		['A'] = { CH_SUBSYSTEM, POP,  ST_TASK_ALLOC },
 		['c'] = { CH_SUBSYSTEM, PUSH, ST_TASK_CHECK_DEPS },
@@ -75,21 +74,21 @@ static const int fn_table[256][256][3] = {
 		['y'] = { CH_SUBSYSTEM, PUSH, ST_TASK_TASKYIELD },
 		['Y'] = { CH_SUBSYSTEM, POP,  ST_TASK_TASKYIELD },
 	},
-	['A'] = {
+	['A'] = STATE_ROW {
 		['['] = { CH_SUBSYSTEM, PUSH, ST_RT_ATTACHED },
 		[']'] = { CH_SUBSYSTEM, POP,  ST_RT_ATTACHED },
 	},
-	['M'] = {
+	['M'] = STATE_ROW {
 		['i'] = { CH_SUBSYSTEM, PUSH, ST_RT_MICROTASK_INTERNAL },
 		['I'] = { CH_SUBSYSTEM, POP,  ST_RT_MICROTASK_INTERNAL },
 		['u'] = { CH_SUBSYSTEM, PUSH, ST_RT_MICROTASK_USER },
 		['U'] = { CH_SUBSYSTEM, POP,  ST_RT_MICROTASK_USER },
 	},
-	['H'] = {
+	['H'] = STATE_ROW {
 		['['] = { CH_SUBSYSTEM, PUSH, ST_RT_WORKER_LOOP },
 		[']'] = { CH_SUBSYSTEM, POP,  ST_RT_WORKER_LOOP },
 	},
-	['C'] = {
+	['C'] = STATE_ROW {
 		['i'] = { CH_SUBSYSTEM, PUSH, ST_RT_INIT },
 		['I'] = { CH_SUBSYSTEM, POP,  ST_RT_INIT },
 		['f'] = { CH_SUBSYSTEM, PUSH, ST_RT_FORK_CALL },
@@ -105,10 +104,11 @@ simple(struct emu *emu)
 		return -1;
 	}
 
-	const int *entry = fn_table[emu->ev->c][emu->ev->v];
-	int chind = entry[0];
-	int action = entry[1];
-	int st = entry[2];
+	const struct state_entry *entry = state_table_get(fn_table,
+			emu->ev->c, emu->ev->v);
+	int chind = entry->chan;
+	int action = entry->action;
+	int st = entry->st;
 
 	struct openmp_thread *th = EXT(emu->thread, 'P');
 	struct chan *ch = &th->m.ch[chind];
@@ -232,41 +232,9 @@ update_task(struct emu *emu)
 	return 0;
 }
 
-static int
-pre_task(struct emu *emu)
-{
-	int ret = 0;
-	switch (emu->ev->v) {
-		case 'c':
-			ret = create_task(emu);
-			break;
-		case 'x':
-		case 'e':
-			ret = update_task(emu);
-			break;
-		default:
-			err("unexpected task event value");
-			return -1;
-	}
-
-	if (ret != 0) {
-		err("cannot update task state");
-		return -1;
-	}
-
-	return 0;
-}
-
 static int
 pre_type(struct emu *emu)
 {
-	uint8_t value = emu->ev->v;
-
-	if (value != 'c') {
-		err("unexpected event value %c", value);
-		return -1;
-	}
-
 	if (!emu->ev->is_jumbo) {
 		err("expecting a jumbo event");
 		return -1;
@@ -335,70 +303,42 @@ update_ws_state(struct emu *emu, uint8_t action)
 }
 
 static int
-pre_worksharing(struct emu *emu)
+enter_worksharing(struct emu *emu)
 {
-	int ret = 0;
-	switch (emu->ev->v) {
-		case 'x':
-		case 'e':
-			ret = update_ws_state(emu, emu->ev->v);
-			break;
-		default:
-			err("unexpected ws event value %c", emu->ev->v);
-			return -1;
-	}
-
-	if (ret != 0) {
-		err("cannot update worksharing channels");
-		return -1;
-	}
-
-	return 0;
+	return update_ws_state(emu, 'x');
 }
 
 static int
-process_ev(struct emu *emu)
+leave_worksharing(struct emu *emu)
 {
-	if (!emu->thread->is_running) {
-		err("current thread %d not running", emu->thread->tid);
-		return -1;
-	}
-	switch (emu->ev->c) {
-		case 'B':
-		case 'I':
-		case 'W':
-		case 'T':
-		case 'A':
-		case 'M':
-		case 'H':
-		case 'C':
-			return simple(emu);
-		case 'P':
-			return pre_task(emu);
-		case 'O':
-			return pre_type(emu);
-		case 'Q':
-			return pre_worksharing(emu);
-	}
-
-	err("unknown event category");
-	return -1;
+	return update_ws_state(emu, 'e');
 }
 
 int
-model_openmp_event(struct emu *emu)
+model_openmp_check(struct emu *emu)
 {
-	dbg("in openmp_event");
-	if (emu->ev->m != 'P') {
-		err("unexpected event model %c", emu->ev->m);
-		return -1;
-	}
-
-	dbg("got openmp event %s", emu->ev->mcv);
-	if (process_ev(emu) != 0) {
-		err("error processing openmp event");
+	if (!emu->thread->is_running) {
+		err("current thread %d not running", emu->thread->tid);
 		return -1;
 	}
 
 	return 0;
 }
+
+struct model_handler model_openmp_handlers[] = {
+	{ "PB", simple },
+	{ "PI", simple },
+	{ "PW", simple },
+	{ "PT", simple },
+	{ "PA", simple },
+	{ "PM", simple },
+	{ "PH", simple },
+	{ "PC", simple },
+	{ "PPc", create_task },
+	{ "PPx", update_task },
+	{ "PPe", update_task },
+	{ "POc", pre_type },
+	{ "PQx", enter_worksharing },
+	{ "PQe", leave_worksharing },
+	{ NULL, NULL },
+};
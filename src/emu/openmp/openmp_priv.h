@@ -5,6 +5,7 @@
 #define OPENMP_PRIV_H
 
 #include "emu.h"
+#include "model.h"
 #include "task.h"
 #include "model_cpu.h"
 #include "model_thread.h"
@@ -79,9 +80,11 @@ struct openmp_emu {
 int model_openmp_probe(struct emu *emu);
 int model_openmp_create(struct emu *emu);
 int model_openmp_connect(struct emu *emu);
-int model_openmp_event(struct emu *emu);
+int model_openmp_check(struct emu *emu);
 int model_openmp_finish(struct emu *emu);
 
+extern struct model_handler model_openmp_handlers[];
+
 int model_openmp_breakdown_create(struct emu *emu);
 int model_openmp_breakdown_connect(struct emu *emu);
 int model_openmp_breakdown_finish(struct emu *emu,
@@ -87,7 +87,8 @@ struct model_spec model_openmp = {
 	.model = model_id,
 	.create  = model_openmp_create,
 	.connect = model_openmp_connect,
-	.event   = model_openmp_event,
+	.check   = model_openmp_check,
+	.handlers = model_openmp_handlers,
 	.probe   = model_openmp_probe,
 	.finish  = model_openmp_finish,
 };
@@ -19,8 +19,10 @@
 #include "mark.h"
 
 static int
-pre_thread_execute(struct emu *emu, struct thread *th)
+pre_thread_execute(struct emu *emu)
 {
+	struct thread *th = emu->thread;
+
 	/* The thread cannot be already running */
 	if (th->state == TH_ST_RUNNING) {
 		err("cannot execute thread %d, is already running", th->tid);
@@ -66,8 +68,10 @@ pre_thread_execute(struct emu *emu, struct thread *th)
 }
 
 static int
-pre_thread_end(struct thread *th)
+pre_thread_end(struct emu *emu)
 {
+	struct thread *th = emu->thread;
+
 	if (th->state != TH_ST_RUNNING && th->state != TH_ST_COOLING) {
 		err("cannot end thread %d: state not running or cooling",
 				th->tid);
@@ -94,8 +98,10 @@ pre_thread_end(struct thread *th)
 }
 
 static int
-pre_thread_pause(struct thread *th)
+pre_thread_pause(struct emu *emu)
 {
+	struct thread *th = emu->thread;
+
 	if (th->state != TH_ST_RUNNING && th->state != TH_ST_COOLING) {
 		err("cannot pause thread %d: state not running or cooling",
 				th->tid);
@@ -116,8 +122,10 @@ pre_thread_pause(struct thread *th)
 }
 
 static int
-pre_thread_resume(struct thread *th)
+pre_thread_resume(struct emu *emu)
 {
+	struct thread *th = emu->thread;
+
 	if (th->state != TH_ST_PAUSED && th->state != TH_ST_WARMING) {
 		err("cannot resume thread %d: state not paused or warming",
 				th->tid);
@@ -138,8 +146,10 @@ pre_thread_resume(struct thread *th)
 }
 
 static int
-pre_thread_cool(struct thread *th)
+pre_thread_cool(struct emu *emu)
 {
+	struct thread *th = emu->thread;
+
 	if (th->state != TH_ST_RUNNING) {
 		err("cannot cool thread %d: state not running", th->tid);
 		return -1;
@@ -159,8 +169,10 @@ pre_thread_cool(struct thread *th)
 }
 
 static int
-pre_thread_warm(struct thread *th)
+pre_thread_warm(struct emu *emu)
 {
+	struct thread *th = emu->thread;
+
 	if (th->state != TH_ST_PAUSED) {
 		err("cannot warm thread %d: state not paused", th->tid);
 		return -1;
@@ -180,36 +192,17 @@ pre_thread_warm(struct thread *th)
 }
 
 static int
-pre_thread(struct emu *emu)
+pre_thread_create(struct emu *emu)
 {
 	struct thread *th = emu->thread;
 	struct emu_ev *ev = emu->ev;
 
-	switch (ev->v) {
-		case 'C': /* create */
-			dbg("thread %d creates a new thread at cpu=%d with args=%x %x",
-					th->tid,
-					ev->payload->u32[0],
-					ev->payload->u32[1],
-					ev->payload->u32[2]);
-
-			break;
-		case 'x':
-			return pre_thread_execute(emu, th);
-		case 'e':
-			return pre_thread_end(th);
-		case 'p':
-			return pre_thread_pause(th);
-		case 'r':
-			return pre_thread_resume(th);
-		case 'c':
-			return pre_thread_cool(th);
-		case 'w':
-			return pre_thread_warm(th);
-		default:
-			err("unknown thread event value %c", ev->v);
-			return -1;
-	}
+	dbg("thread %d creates a new thread at cpu=%d with args=%x %x",
+			th->tid,
+			ev->payload->u32[0],
+			ev->payload->u32[1],
+			ev->payload->u32[2]);
+
 	return 0;
 }
 
@@ -324,35 +317,10 @@ pre_affinity_remote(struct emu *emu)
 }
 
 static int
-pre_affinity(struct emu *emu)
-{
-	switch (emu->ev->v) {
-		case 's':
-			return pre_affinity_set(emu);
-		case 'r':
-			return pre_affinity_remote(emu);
-		default:
-			err("unknown affinity event value %c",
-					emu->ev->v);
-			return -1;
-	}
-
-	return 0;
-}
-
-static int
-pre_cpu(struct emu *emu)
+pre_cpu_old(struct emu *emu)
 {
-	switch (emu->ev->v) {
-		case 'n':
-			warn("ignoring old event OCn");
-			return 0;
-		default:
-			err("unknown cpu event value %c",
-					emu->ev->v);
-			return -1;
-	}
-
+	UNUSED(emu);
+	warn("ignoring old event OCn");
 	return 0;
 }
 
@@ -415,76 +383,76 @@ pre_burst(struct emu *emu)
 }
 
 static int
-pre_flush(struct emu *emu)
+pre_flush_begin(struct emu *emu)
 {
 	struct ovni_thread *th = EXT(emu->thread, 'O');
 	struct chan *flush = &th->m.ch[CH_FLUSH];
 
-	switch (emu->ev->v) {
-		case '[':
-			if (chan_set(flush, value_int64(1)) != 0) {
-				err("chan_set failed");
-				return -1;
-			}
-			th->flush_start = emu->ev->dclock;
-			break;
-		case ']':
-			if (chan_set(flush, value_null()) != 0) {
-				err("chan_set failed");
-				return -1;
-			}
-			int64_t flush_ns = emu->ev->dclock - th->flush_start;
-			double flush_ms = (double) flush_ns * 1e-6;
-			/* Avoid last flush warnings */
-			if (flush_ms > 10.0 && emu->thread->is_running)
-				warn("large flush of %.1f ms at dclock=%"PRIi64" ns in tid=%d",
-						flush_ms,
-						emu->ev->dclock,
-						emu->thread->tid);
-			break;
-		default:
-			err("unexpected value '%c' (expecting '[' or ']')",
-					emu->ev->v);
-			return -1;
+	if (chan_set(flush, value_int64(1)) != 0) {
+		err("chan_set failed");
+		return -1;
 	}
+	th->flush_start = emu->ev->dclock;
 
 	return 0;
 }
 
-int
-model_ovni_event(struct emu *emu)
+static int
+pre_flush_end(struct emu *emu)
 {
-	if (emu->ev->m != 'O') {
-		err("unexpected event model %c", emu->ev->m);
+	struct ovni_thread *th = EXT(emu->thread, 'O');
+	struct chan *flush = &th->m.ch[CH_FLUSH];
+
+	if (chan_set(flush, value_null()) != 0) {
+		err("chan_set failed");
 		return -1;
 	}
+	int64_t flush_ns = emu->ev->dclock - th->flush_start;
+	double flush_ms = (double) flush_ns * 1e-6;
+	/* Avoid last flush warnings */
+	if (flush_ms > 10.0 && emu->thread->is_running)
+		warn("large flush of %.1f ms at dclock=%"PRIi64" ns in tid=%d",
+				flush_ms,
+				emu->ev->dclock,
+				emu->thread->tid);
+
+	return 0;
+}
 
+/* Ignore sorting events */
+static int
+pre_sort(struct emu *emu)
+{
+	UNUSED(emu);
+	return 0;
+}
+
+int
+model_ovni_check(struct emu *emu)
+{
 	if (emu->thread->is_out_of_cpu) {
 		err("current thread %d out of CPU", emu->thread->tid);
 		return -1;
 	}
 
-	switch (emu->ev->c) {
-		case 'H':
-			return pre_thread(emu);
-		case 'A':
-			return pre_affinity(emu);
-		case 'B':
-			return pre_burst(emu);
-		case 'C':
-			return pre_cpu(emu);
-		case 'F':
-			return pre_flush(emu);
-		case 'U':
-			/* Ignore sorting events */
-			return 0;
-		case 'M':
-			return mark_event(emu);
-		default:
-			err("unknown ovni event category %c",
-					emu->ev->c);
-			return -1;
-	}
-
 	return 0;
 }
+
+struct model_handler model_ovni_handlers[] = {
+	{ "OHC", pre_thread_create },
+	{ "OHx", pre_thread_execute },
+	{ "OHe", pre_thread_end },
+	{ "OHp", pre_thread_pause },
+	{ "OHr", pre_thread_resume },
+	{ "OHc", pre_thread_cool },
+	{ "OHw", pre_thread_warm },
+	{ "OAs", pre_affinity_set },
+	{ "OAr", pre_affinity_remote },
+	{ "OB.", pre_burst },
+	{ "OCn", pre_cpu_old },
+	{ "OF[", pre_flush_begin },
+	{ "OF]", pre_flush_end },
+	{ "OU", pre_sort },
+	{ "OM", mark_event },
+	{ NULL, NULL },
+};
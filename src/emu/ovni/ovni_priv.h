@@ -10,6 +10,7 @@
  * execution by the kernel. */
 
 #include "emu.h"
+#include "model.h"
 #include "mark.h"
 #include "model_cpu.h"
 #include "model_thread.h"
@@ -50,7 +51,9 @@ struct ovni_emu {
 int model_ovni_probe(struct emu *emu);
 int model_ovni_create(struct emu *emu);
 int model_ovni_connect(struct emu *emu);
-int model_ovni_event(struct emu *emu);
+int model_ovni_check(struct emu *emu);
 int model_ovni_finish(struct emu *emu);
 
+extern struct model_handler model_ovni_handlers[];
+
 #endif /* OVNI_PRIV_H */
@@ -53,7 +53,8 @@ struct model_spec model_ovni = {
 	.model   = model_id,
 	.create  = model_ovni_create,
 	.connect = model_ovni_connect,
-	.event   = model_ovni_event,
+	.check   = model_ovni_check,
+	.handlers = model_ovni_handlers,
 	.probe   = model_ovni_probe,
 	.finish  = model_ovni_finish,
 };
@@ -0,0 +1,95 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "common.h"
+#include "pv/prv_bin.h"
+
+static int nthreads = 1;
+
+static void
+usage(void)
+{
+	rerr("Usage: ovni2prv [-j N] FILE.bprv...\n");
+	rerr("\n");
+	rerr("Convert the binary logs written by ovniemu -z to PRV files.\n");
+	rerr("\n");
+	rerr("  -j N       Format the blocks of each log in N threads.\n");
+	rerr("  FILE.bprv  Binary log, converted to FILE.prv.\n");
+	rerr("\n");
+
+	exit(EXIT_FAILURE);
+}
+
+static void
+parse_args(int argc, char *argv[])
+{
+	int opt;
+
+	while ((opt = getopt(argc, argv, "hj:")) != -1) {
+		switch (opt) {
+			case 'j':
+				nthreads = atoi(optarg);
+				if (nthreads < 1 || nthreads > 4096) {
+					err("invalid number of threads '%s'", optarg);
+					usage();
+				}
+				break;
+			case 'h':
+			default: /* '?' */
+				usage();
+		}
+	}
+
+	if (optind >= argc) {
+		err("bad usage: missing file");
+		usage();
+	}
+}
+
+static int
+convert(const char *inpath)
+{
+	size_t n = strlen(inpath);
+	const char *ext = ".bprv";
+	size_t extlen = strlen(ext);
+
+	if (n <= extlen || strcmp(inpath + n - extlen, ext) != 0) {
+		err("missing %s extension in '%s'", ext, inpath);
+		return -1;
+	}
+
+	char outpath[PATH_MAX];
+	int len = (int) (n - extlen);
+	if (snprintf(outpath, PATH_MAX, "%.*s.prv", len, inpath) >= PATH_MAX) {
+		err("path too long: %s", inpath);
+		return -1;
+	}
+
+	if (prv_bin_convert(inpath, outpath, nthreads) != 0) {
+		err("cannot convert '%s'", inpath);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+	progname_set("ovni2prv");
+
+	parse_args(argc, argv);
+
+	int ret = 0;
+	for (int i = optind; i < argc; i++) {
+		if (convert(argv[i]) != 0)
+			ret = 1;
+	}
+
+	return ret;
+}
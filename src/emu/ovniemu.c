@@ -3,8 +3,13 @@
 
 #include "emu.h"
 
+#include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 #include "common.h"
 
 static volatile int run = 1;
@@ -16,6 +21,116 @@ static void stop_emulation(int dummy)
 	signal(SIGINT, SIG_DFL);
 }
 
+static int
+play(struct emu *emu)
+{
+	int ret = 0;
+	while (run && (ret = emu_step(emu)) == 0);
+
+	if (ret < 0) {
+		err("emu_step failed");
+		/* continue to close the trace files */
+		info("emulation aborts!");
+		return 1;
+	}
+
+	if (run == 0)
+		info("stopping emulation by user (^C again to abort)");
+
+	return 0;
+}
+
+/* Emulates the looms of one part in a child process */
+static int
+worker(struct emu *emu, int part)
+{
+	static char name[64];
+	snprintf(name, sizeof(name), "ovniemu[%d]", part);
+	progname_set(name);
+
+	if (emu_split(emu, part) != 0) {
+		err("emu_split failed");
+		return 1;
+	}
+
+	int ret = play(emu);
+
+	if (emu_finish_part(emu) != 0) {
+		err("emu_finish_part failed");
+		ret = 1;
+	}
+
+	return ret;
+}
+
+static int
+wait_worker(pid_t pid, int part)
+{
+	int status;
+	while (waitpid(pid, &status, 0) < 0) {
+		if (errno != EINTR) {
+			err("waitpid failed:");
+			return -1;
+		}
+	}
+
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+		err("worker %d failed", part);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+play_parallel(struct emu *emu)
+{
+	int n = emu->nparts;
+	pid_t *pids = calloc((size_t) n, sizeof(pid_t));
+	if (pids == NULL) {
+		err("calloc failed:");
+		return 1;
+	}
+
+	info("emulating %d parts in parallel", n);
+
+	/* Don't let the children write what is still buffered */
+	fflush(NULL);
+
+	int ret = 0;
+	int started = 0;
+	for (; started < n; started++) {
+		pid_t pid = fork();
+		if (pid < 0) {
+			err("fork failed:");
+			ret = 1;
+			break;
+		} else if (pid == 0) {
+			exit(worker(emu, started));
+		}
+
+		pids[started] = pid;
+	}
+
+	for (int i = 0; i < started; i++) {
+		if (wait_worker(pids[i], i) != 0)
+			ret = 1;
+	}
+
+	free(pids);
+
+	/* Merge what the workers have written even if some failed */
+	if (started < n)
+		return ret;
+
+	if (emu_merge(emu) != 0) {
+		err("emu_merge failed");
+		ret = 1;
+	}
+
+	return ret;
+}
+
 int
 main(int argc, char *argv[])
 {
@@ -42,30 +157,19 @@ main(int argc, char *argv[])
 
 	info("emulation starts");
 	int ret = 0;
-	int partial = 0;
-	while (run && (ret = emu_step(emu)) == 0);
-
-	if (ret < 0) {
-		err("emu_step failed");
-		ret = 1;
-		/* continue to close the trace files */
-		info("emulation aborts!");
+	if (emu->nparts > 1) {
+		ret = play_parallel(emu);
 	} else {
-		ret = 0;
-	}
-
-	if (run == 0) {
-		info("stopping emulation by user (^C again to abort)");
-		partial = 1;
-	}
+		ret = play(emu);
 
-	if (emu_finish(emu) != 0) {
-		err("emu_finish failed");
-		ret = 1;
+		if (emu_finish(emu) != 0) {
+			err("emu_finish failed");
+			ret = 1;
+		}
 	}
 
 	if (ret == 0) {
-		if (partial) {
+		if (run == 0) {
 			info("emulation finished partially but ok");
 		} else {
 			info("emulation finished ok");
@@ -361,7 +361,7 @@ execute_sort_plan(struct sortplan *sp)
 static int
 stream_winsort(struct stream *stream, struct ring *r)
 {
-	char *fn = stream->obspath;
+	const char *fn = stream->obspath;
 	int fd = open(fn, O_WRONLY);
 
 	if (fd < 0)
@@ -489,7 +489,8 @@ process_trace(struct trace *trace)
 	if (ring.ev == NULL)
 		die("malloc failed:");
 
-	for (struct stream *stream = trace->streams; stream; stream = stream->next) {
+	for (long i = 0; i < trace->nstreams; i++) {
+		struct stream *stream = &trace->streams[i];
 		stream_allow_unsorted(stream);
 
 		if (operation_mode == SORT) {
@@ -1,4 +1,4 @@
-/* Copyright (c) 2023 Barcelona Supercomputing Center (BSC)
+/* Copyright (c) 2023-2025 Barcelona Supercomputing Center (BSC)
  * SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include <stdio.h>
@@ -19,12 +19,17 @@ struct entry {
 	UT_hash_handle hh;
 };
 
+/* Number of events played between stats updates */
+#define BATCH 1024
+
 char *tracedir;
 struct entry *table = NULL;
 
-static void
-accum(struct player *player)
+static int
+accum(struct player *player, void *arg)
 {
+	UNUSED(arg);
+
 	struct emu_ev *ev = player_ev(player);
 	struct entry *e = NULL;
 	HASH_FIND_STR(table, ev->mcv, e);
@@ -40,6 +45,8 @@ accum(struct player *player)
 	} else {
 		e->count++;
 	}
+
+	return 0;
 }
 
 static int
@@ -140,10 +147,9 @@ main(int argc, char *argv[])
 
 	emu_stat_init(&stat);
 
-	while ((ret = player_step(player)) == 0) {
-		accum(player);
+	/* No need to update the stats after every event */
+	while ((ret = player_step_n(player, BATCH, accum, NULL)) == 0)
 		emu_stat_update(&stat, player);
-	}
 
 	emu_stat_report(&stat, player, 1);
 
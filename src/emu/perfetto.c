@@ -0,0 +1,394 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "perfetto.h"
+#include <fcntl.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "bay.h"
+#include "chan.h"
+#include "pv/pcf.h"
+#include "pv/prf.h"
+#include "pv/prv.h"
+#include "value.h"
+#include "varint.h"
+
+/* Only the fields of the Perfetto protos that we write, see
+ * protos/perfetto/trace/trace_packet.proto and track_event/ in the
+ * Perfetto sources. The trace is a sequence of Trace.packet fields. */
+enum {
+	TRACE_PACKET = 1,
+
+	PACKET_TIMESTAMP = 8,
+	PACKET_SEQUENCE_ID = 10, /* trusted_packet_sequence_id */
+	PACKET_TRACK_EVENT = 11,
+	PACKET_INTERNED_DATA = 12,
+	PACKET_SEQUENCE_FLAGS = 13,
+	PACKET_TRACK_DESCRIPTOR = 60,
+
+	TRACK_EVENT_TYPE = 9,
+	TRACK_EVENT_NAME_IID = 10,
+	TRACK_EVENT_TRACK_UUID = 11,
+
+	INTERNED_EVENT_NAMES = 2,
+	EVENT_NAME_IID = 1,
+	EVENT_NAME_NAME = 2,
+
+	TRACK_DESC_UUID = 1,
+	TRACK_DESC_NAME = 2,
+	TRACK_DESC_PARENT_UUID = 5,
+};
+
+enum {
+	WIRE_VARINT = 0,
+	WIRE_LEN = 2,
+};
+
+enum {
+	SLICE_BEGIN = 1,
+	SLICE_END = 2,
+};
+
+enum {
+	SEQ_INCREMENTAL_STATE_CLEARED = 1,
+	SEQ_NEEDS_INCREMENTAL_STATE = 2,
+};
+
+/* All the packets are written in the same sequence */
+#define SEQUENCE_ID 1
+
+static char *
+put_uint(char *p, int field, uint64_t v)
+{
+	p = varint_put_u64(p, (uint64_t) field << 3 | WIRE_VARINT);
+	return varint_put_u64(p, v);
+}
+
+static char *
+put_bytes(char *p, int field, const char *data, size_t n)
+{
+	p = varint_put_u64(p, (uint64_t) field << 3 | WIRE_LEN);
+	p = varint_put_u64(p, n);
+	memcpy(p, data, n);
+	return p + n;
+}
+
+static int
+flush(struct perfetto *pft)
+{
+	if (write_all(pft->fd, pft->buf, pft->len) != 0)
+		return -1;
+
+	pft->len = 0;
+	return 0;
+}
+
+/* Appends the packet to the trace */
+static int
+put_packet(struct perfetto *pft, const char *pkt, size_t n)
+{
+	if (PERFETTO_BUFSIZE - pft->len < n + 16 && flush(pft) != 0)
+		return -1;
+
+	char *p = put_bytes(pft->buf + pft->len, TRACE_PACKET, pkt, n);
+	pft->len = (size_t) (p - pft->buf);
+
+	return 0;
+}
+
+static int
+put_descriptor(struct perfetto *pft, uint64_t uuid, uint64_t parent,
+		const char *name)
+{
+	char desc[PERFETTO_MAXPACKET];
+	char *p = put_uint(desc, TRACK_DESC_UUID, uuid);
+	if (parent != 0)
+		p = put_uint(p, TRACK_DESC_PARENT_UUID, parent);
+	p = put_bytes(p, TRACK_DESC_NAME, name, strlen(name));
+
+	char pkt[PERFETTO_MAXPACKET];
+	char *q = put_uint(pkt, PACKET_SEQUENCE_ID, SEQUENCE_ID);
+	q = put_bytes(q, PACKET_TRACK_DESCRIPTOR, desc, (size_t) (p - desc));
+
+	return put_packet(pft, pkt, (size_t) (q - pkt));
+}
+
+/* Declares the track of the row, named as in the ROW file */
+static int
+declare_row(struct perfetto *pft, long row)
+{
+	if (pft->declared[row])
+		return 0;
+
+	char name[MAX_PRF_LABEL];
+	if (pft->prf != NULL && pft->prf->rows[row].set)
+		snprintf(name, sizeof(name), "%s", pft->prf->rows[row].label);
+	else
+		snprintf(name, sizeof(name), "Row %ld", row + 1);
+
+	/* The tracks of the rows use the first uuids */
+	if (put_descriptor(pft, (uint64_t) row + 1, 0, name) != 0)
+		return -1;
+
+	pft->declared[row] = 1;
+	return 0;
+}
+
+/* Declares the track of the channel inside the track of its row, named
+ * as the PCF type */
+static int
+declare_track(struct perfetto *pft, struct perfetto_track *t)
+{
+	if (declare_row(pft, t->row) != 0)
+		return -1;
+
+	char name[MAX_PCF_LABEL];
+	struct pcf_type *type = NULL;
+	if (pft->pcf != NULL)
+		type = pcf_find_type(pft->pcf, (int) t->type);
+
+	if (type != NULL)
+		snprintf(name, sizeof(name), "%s", type->label);
+	else
+		snprintf(name, sizeof(name), "Type %ld", t->type);
+
+	t->uuid = pft->next_uuid++;
+
+	return put_descriptor(pft, t->uuid, (uint64_t) t->row + 1, name);
+}
+
+/* Looks for the interned name of the value, or interns it in the given
+ * InternedData message, which is left empty if already interned */
+static int
+find_name(struct perfetto *pft, struct perfetto_track *t, int64_t value,
+		uint64_t *iid, char *interned, size_t *len)
+{
+	int64_t key[2] = { t->type, value };
+	struct perfetto_name *name = NULL;
+	HASH_FIND(hh, pft->names, key, sizeof(key), name);
+
+	*len = 0;
+	if (name != NULL) {
+		*iid = name->iid;
+		return 0;
+	}
+
+	name = calloc(1, sizeof(struct perfetto_name));
+	if (name == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	memcpy(name->key, key, sizeof(key));
+	name->iid = pft->next_iid++;
+	HASH_ADD(hh, pft->names, key, sizeof(key), name);
+
+	char label[MAX_PCF_LABEL];
+	struct pcf_type *type = NULL;
+	struct pcf_value *pcfvalue = NULL;
+	if (pft->pcf != NULL)
+		type = pcf_find_type(pft->pcf, (int) t->type);
+	if (type != NULL && value >= INT32_MIN && value <= INT32_MAX)
+		pcfvalue = pcf_find_value(type, (int) value);
+
+	if (pcfvalue != NULL)
+		snprintf(label, sizeof(label), "%s", pcfvalue->label);
+	else
+		snprintf(label, sizeof(label), "%" PRIi64, value);
+
+	char ev[PERFETTO_MAXPACKET];
+	char *p = put_uint(ev, EVENT_NAME_IID, name->iid);
+	p = put_bytes(p, EVENT_NAME_NAME, label, strlen(label));
+
+	char *q = put_bytes(interned, INTERNED_EVENT_NAMES, ev, (size_t) (p - ev));
+	*len = (size_t) (q - interned);
+	*iid = name->iid;
+
+	return 0;
+}
+
+/* Begins a slice with the name of the value in the track, or ends the
+ * open slice if the value is zero */
+static int
+put_slice(struct perfetto *pft, struct perfetto_track *t, int64_t value)
+{
+	char ev[64];
+	char *p = put_uint(ev, TRACK_EVENT_TYPE, value ? SLICE_BEGIN : SLICE_END);
+	p = put_uint(p, TRACK_EVENT_TRACK_UUID, t->uuid);
+
+	char interned[PERFETTO_MAXPACKET];
+	size_t ninterned = 0;
+	if (value != 0) {
+		uint64_t iid;
+		if (find_name(pft, t, value, &iid, interned, &ninterned) != 0)
+			return -1;
+		p = put_uint(p, TRACK_EVENT_NAME_IID, iid);
+	}
+
+	char pkt[PERFETTO_MAXPACKET];
+	char *q = put_uint(pkt, PACKET_TIMESTAMP, (uint64_t) pft->time);
+	q = put_uint(q, PACKET_SEQUENCE_ID, SEQUENCE_ID);
+	q = put_bytes(q, PACKET_TRACK_EVENT, ev, (size_t) (p - ev));
+	if (ninterned > 0)
+		q = put_bytes(q, PACKET_INTERNED_DATA, interned, ninterned);
+
+	/* Only the names depend on the interned data */
+	if (value != 0)
+		q = put_uint(q, PACKET_SEQUENCE_FLAGS, SEQ_NEEDS_INCREMENTAL_STATE);
+
+	return put_packet(pft, pkt, (size_t) (q - pkt));
+}
+
+static int
+emit(struct perfetto *pft, struct perfetto_track *t)
+{
+	struct value value;
+	if (chan_read(t->chan, &value) != 0) {
+		err("chan_read %s failed", t->chan->name);
+		return -1;
+	}
+
+	/* Null values end the slice, as zero in the PRV */
+	int64_t val = prv_value(&value, t->flags);
+
+	/* Duplicates only begin a new slice with PRV_EMITDUP */
+	if (val == t->value && (~t->flags & PRV_EMITDUP))
+		return 0;
+
+	if (t->uuid == 0 && declare_track(pft, t) != 0)
+		return -1;
+
+	if (t->value != 0 && put_slice(pft, t, 0) != 0)
+		return -1;
+
+	if (val != 0 && put_slice(pft, t, val) != 0)
+		return -1;
+
+	t->value = val;
+
+	return 0;
+}
+
+static int
+cb_perfetto(struct chan *chan, void *ptr)
+{
+	UNUSED(chan);
+	struct perfetto_track *t = ptr;
+
+	return emit(t->pft, t);
+}
+
+int
+perfetto_open(struct perfetto *pft, long nrows, const char *path,
+		struct pcf *pcf, struct prf *prf)
+{
+	memset(pft, 0, sizeof(struct perfetto));
+
+	pft->nrows = nrows;
+	pft->pcf = pcf;
+	pft->prf = prf;
+	pft->next_uuid = (uint64_t) nrows + 1;
+	pft->next_iid = 1;
+
+	pft->buf = malloc(PERFETTO_BUFSIZE);
+	pft->declared = calloc((size_t) nrows + 1, 1);
+	if (pft->buf == NULL || pft->declared == NULL) {
+		err("malloc failed:");
+		return -1;
+	}
+
+	pft->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if (pft->fd < 0) {
+		err("cannot open file '%s' for writting:", path);
+		return -1;
+	}
+
+	/* The interned names start in the first packet */
+	char pkt[16];
+	char *p = put_uint(pkt, PACKET_SEQUENCE_ID, SEQUENCE_ID);
+	p = put_uint(p, PACKET_SEQUENCE_FLAGS, SEQ_INCREMENTAL_STATE_CLEARED);
+
+	return put_packet(pft, pkt, (size_t) (p - pkt));
+}
+
+int
+perfetto_register(struct perfetto *pft, long row, long type,
+		struct bay *bay, struct chan *chan, long flags)
+{
+	if (row < 0 || row >= pft->nrows) {
+		err("row %ld out of bounds", row);
+		return -1;
+	}
+
+	struct perfetto_track *t = calloc(1, sizeof(struct perfetto_track));
+	if (t == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	t->pft = pft;
+	t->chan = chan;
+	t->row = row;
+	t->type = type;
+	t->flags = flags;
+
+	if (bay_add_cb(bay, BAY_CB_EMIT, chan, cb_perfetto, t, 1) == NULL) {
+		err("bay_add_cb failed");
+		free(t);
+		return -1;
+	}
+
+	t->next = pft->tracks;
+	pft->tracks = t;
+
+	return 0;
+}
+
+int
+perfetto_advance(struct perfetto *pft, int64_t time)
+{
+	if (time < pft->time) {
+		err("cannot move to previous time");
+		return -1;
+	}
+
+	pft->time = time;
+	return 0;
+}
+
+/* Ends the open slices and writes the rest of the trace */
+int
+perfetto_close(struct perfetto *pft)
+{
+	int ret = 0;
+
+	for (struct perfetto_track *t = pft->tracks; t; t = t->next) {
+		if (t->value != 0 && put_slice(pft, t, 0) != 0)
+			ret = -1;
+		t->value = 0;
+	}
+
+	if (flush(pft) != 0)
+		ret = -1;
+
+	if (close(pft->fd) != 0) {
+		err("close failed:");
+		ret = -1;
+	}
+
+	struct perfetto_name *name, *tmp;
+	HASH_ITER(hh, pft->names, name, tmp) {
+		HASH_DEL(pft->names, name);
+		free(name);
+	}
+
+	free(pft->buf);
+	free(pft->declared);
+	pft->buf = NULL;
+	pft->declared = NULL;
+
+	return ret;
+}
@@ -0,0 +1,68 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#ifndef PERFETTO_H
+#define PERFETTO_H
+
+/* Exports the channels registered in a PRV file as a Perfetto trace. Each
+ * row (thread or CPU) becomes a track with one child track per PRV type,
+ * where the values are slices named by the PCF labels. The trace is
+ * written with a minimal protobuf encoder, see perfetto.c. */
+
+#include <stddef.h>
+#include <stdint.h>
+#include "common.h"
+#include "uthash.h"
+struct bay;
+struct chan;
+struct pcf;
+struct prf;
+
+#define PERFETTO_BUFSIZE (1024*1024)
+
+/* Longest packet, with the labels of the PCF and ROW files */
+#define PERFETTO_MAXPACKET 2048
+
+struct perfetto_track {
+	struct perfetto *pft;
+	struct chan *chan;
+	long row;
+	long type;
+	long flags; /* As in prv_register() */
+	uint64_t uuid; /* Zero until declared */
+	int64_t value; /* Of the open slice, or zero */
+	struct perfetto_track *next;
+};
+
+/* Interned name of the slices of one type and value */
+struct perfetto_name {
+	int64_t key[2];
+	uint64_t iid;
+	UT_hash_handle hh;
+};
+
+struct perfetto {
+	int fd;
+	char *buf;
+	size_t len;
+
+	int64_t time;
+	long nrows;
+	struct pcf *pcf; /* For the slice and track names */
+	struct prf *prf;
+
+	char *declared; /* Of each row track */
+	uint64_t next_uuid;
+	uint64_t next_iid;
+	struct perfetto_track *tracks;
+	struct perfetto_name *names;
+};
+
+USE_RET int perfetto_open(struct perfetto *pft, long nrows, const char *path,
+		struct pcf *pcf, struct prf *prf);
+USE_RET int perfetto_register(struct perfetto *pft, long row, long type,
+		struct bay *bay, struct chan *chan, long flags);
+USE_RET int perfetto_advance(struct perfetto *pft, int64_t time);
+USE_RET int perfetto_close(struct perfetto *pft);
+
+#endif /* PERFETTO_H */
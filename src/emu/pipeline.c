@@ -0,0 +1,230 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "pipeline.h"
+#include <errno.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include "emu_stat.h"
+#include "player.h"
+#include "pv/prv.h"
+#include "recorder.h"
+#include "stream.h"
+
+/* Number of elements of each queue, enough to let each stage run ahead
+ * without using too much memory */
+#define PIPELINE_NEVENTS 4096
+#define PIPELINE_NRECORDS 16384
+
+static int
+must_stop(atomic_int *flag)
+{
+	return atomic_load_explicit(flag, memory_order_acquire);
+}
+
+static void *
+decode(void *arg)
+{
+	struct pipeline *p = arg;
+
+	while (!must_stop(&p->stop_decoder)) {
+		int ret = player_step(p->player);
+		if (ret == 0)
+			emu_stat_update(p->stat, p->player);
+
+		struct pipeline_ev *e;
+		while ((e = spsc_claim(&p->events)) == NULL) {
+			if (must_stop(&p->stop_decoder))
+				return NULL;
+			sched_yield();
+		}
+
+		e->ret = ret;
+		if (ret == 0) {
+			e->ev = *player_ev(p->player);
+			e->stream = player_stream(p->player);
+			e->offset = e->stream->offset;
+		}
+		spsc_push(&p->events);
+
+		/* No more events or error */
+		if (ret != 0)
+			break;
+	}
+
+	return NULL;
+}
+
+static void *
+write_records(void *arg)
+{
+	struct pipeline_writer *w = arg;
+	struct pipeline *p = w->p;
+
+	while (1) {
+		struct prv_rec *rec = spsc_front(&w->records);
+		if (rec == NULL) {
+			if (!must_stop(&p->stop_writer)) {
+				sched_yield();
+				continue;
+			}
+
+			/* Records pushed before the stop are visible now */
+			rec = spsc_front(&w->records);
+			if (rec == NULL)
+				break;
+		}
+
+		if (prv_write_rec(rec) != 0)
+			die("prv_write_rec failed");
+		spsc_pop(&w->records);
+	}
+
+	return NULL;
+}
+
+/* Stops the writers already started and frees all the queues */
+static void
+stop_writers(struct pipeline *p, long nstarted)
+{
+	atomic_store_explicit(&p->stop_writer, 1, memory_order_release);
+	for (long i = 0; i < nstarted; i++)
+		pthread_join(p->writers[i].thread, NULL);
+
+	recorder_set_queues(p->rec, NULL);
+
+	for (long i = 0; i < p->nwriters; i++)
+		spsc_free(&p->writers[i].records);
+
+	free(p->writers);
+	p->writers = NULL;
+	p->nwriters = 0;
+}
+
+/* Starts one writer thread per trace, so the traces are formatted and
+ * written in parallel. Each trace keeps the order of its lines. */
+static int
+start_writers(struct pipeline *p)
+{
+	long n = recorder_ntraces(p->rec);
+
+	p->writers = calloc((size_t) n, sizeof(struct pipeline_writer));
+	if (n > 0 && p->writers == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+	p->nwriters = n;
+
+	struct spsc **queues = calloc((size_t) n + 1, sizeof(struct spsc *));
+	if (queues == NULL) {
+		err("calloc failed:");
+		stop_writers(p, 0);
+		return -1;
+	}
+
+	for (long i = 0; i < n; i++) {
+		struct pipeline_writer *w = &p->writers[i];
+		w->p = p;
+		if (spsc_init(&w->records, sizeof(struct prv_rec), PIPELINE_NRECORDS) != 0) {
+			err("spsc_init failed for records");
+			free(queues);
+			stop_writers(p, 0);
+			return -1;
+		}
+		queues[i] = &w->records;
+	}
+
+	/* From now on, only the writer threads write the PRV lines */
+	recorder_set_queues(p->rec, queues);
+	free(queues);
+
+	for (long i = 0; i < n; i++) {
+		struct pipeline_writer *w = &p->writers[i];
+		int ret = pthread_create(&w->thread, NULL, write_records, w);
+		if (ret != 0) {
+			errno = ret;
+			err("pthread_create failed for the writer:");
+			stop_writers(p, i);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int
+pipeline_start(struct pipeline *p, struct player *player,
+		struct emu_stat *stat, struct recorder *rec)
+{
+	memset(p, 0, sizeof(struct pipeline));
+
+	p->player = player;
+	p->stat = stat;
+	p->rec = rec;
+	atomic_init(&p->stop_decoder, 0);
+	atomic_init(&p->stop_writer, 0);
+
+	if (spsc_init(&p->events, sizeof(struct pipeline_ev), PIPELINE_NEVENTS) != 0) {
+		err("spsc_init failed for events");
+		return -1;
+	}
+
+	if (start_writers(p) != 0) {
+		err("start_writers failed");
+		spsc_free(&p->events);
+		return -1;
+	}
+
+	int ret;
+	if ((ret = pthread_create(&p->decoder, NULL, decode, p)) != 0) {
+		errno = ret;
+		err("pthread_create failed for the decoder:");
+		stop_writers(p, p->nwriters);
+		spsc_free(&p->events);
+		return -1;
+	}
+
+	p->started = 1;
+
+	return 0;
+}
+
+/* Waits for the next event decoded by the decoder thread and copies it in
+ * out. Returns as player_step(). */
+int
+pipeline_next(struct pipeline *p, struct pipeline_ev *out)
+{
+	if (p->finished)
+		return +1;
+
+	struct pipeline_ev *e;
+	while ((e = spsc_front(&p->events)) == NULL)
+		sched_yield();
+
+	*out = *e;
+	spsc_pop(&p->events);
+
+	if (out->ret != 0)
+		p->finished = 1;
+
+	return out->ret;
+}
+
+/* Stops the decoder thread, even if there are events left, and waits for
+ * the writer threads to write all the queued lines */
+int
+pipeline_stop(struct pipeline *p)
+{
+	if (!p->started)
+		return 0;
+
+	atomic_store_explicit(&p->stop_decoder, 1, memory_order_release);
+	pthread_join(p->decoder, NULL);
+
+	stop_writers(p, p->nwriters);
+	spsc_free(&p->events);
+	p->started = 0;
+
+	return 0;
+}
@@ -0,0 +1,58 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+/* Runs the emulation in three stages on their own threads: the decoder
+ * thread merges the streams in the player, the caller thread runs the
+ * models and the bay and one writer thread per trace formats its PRV
+ * lines. */
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include "common.h"
+#include "emu_ev.h"
+#include "spsc.h"
+struct emu_stat;
+struct player;
+struct recorder;
+struct stream;
+
+/* One event queued by the decoder thread */
+struct pipeline_ev {
+	struct emu_ev ev;
+	struct stream *stream;
+	int64_t offset; /* Of the event in the stream */
+	int ret; /* As returned by player_step() */
+};
+
+/* Writes the PRV lines of one trace */
+struct pipeline_writer {
+	struct pipeline *p;
+	struct spsc records; /* From the models to the writer */
+	pthread_t thread;
+};
+
+struct pipeline {
+	struct player *player;
+	struct emu_stat *stat;
+	struct recorder *rec;
+
+	struct spsc events; /* From the decoder to the models */
+	struct pipeline_writer *writers;
+	long nwriters;
+
+	pthread_t decoder;
+	atomic_int stop_decoder;
+	atomic_int stop_writer;
+	int started;
+	int finished;
+};
+
+USE_RET int pipeline_start(struct pipeline *p, struct player *player,
+		struct emu_stat *stat, struct recorder *rec);
+USE_RET int pipeline_next(struct pipeline *p, struct pipeline_ev *out);
+USE_RET int pipeline_stop(struct pipeline *p);
+
+#endif /* PIPELINE_H */
@@ -1,43 +1,142 @@
-/* Copyright (c) 2021-2024 Barcelona Supercomputing Center (BSC)
+/* Copyright (c) 2021-2025 Barcelona Supercomputing Center (BSC)
  * SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include "player.h"
 #include <stdlib.h>
 #include <string.h>
-#include "heap.h"
 #include "stream.h"
 #include "trace.h"
-#include "utlist.h"
-
-/*
- * heap_node_compare_t - comparison function, returns:
-
- * 	> 0 if a > b
- * 	< 0 if a < b
- * 	= 0 if a == b
- *
- * Invert the comparison function to get a min-heap instead.
- * TODO: Consider using an offset from heap_node_t to the int64_t to be
- * compared, so we can optimize the heap insertion.
- */
+
+/* Returns non-zero if the key a must be played before b */
 static inline int
-stream_cmp(heap_node_t *a, heap_node_t *b)
+key_less(const struct player_key *a, const struct player_key *b)
 {
-	struct stream *sa, *sb;
+	if (a->done != b->done)
+		return b->done;
 
-	sa = heap_elem(a, struct stream, hh);
-	sb = heap_elem(b, struct stream, hh);
+	if (a->clock != b->clock)
+		return a->clock < b->clock;
 
-	int64_t ca = stream_lastclock(sa);
-	int64_t cb = stream_lastclock(sb);
+	return a->index < b->index;
+}
 
-	/* Return the opposite, so we have min-heap */
-	if (ca < cb)
-		return +1;
-	else if (ca > cb)
-		return -1;
+static void
+stream_key(struct player *player, int64_t i, struct player_key *key)
+{
+	struct stream *stream = &player->streams[i];
+
+	key->index = (int32_t) i;
+	key->done = !stream->active;
+	key->clock = key->done ? 0 : stream_lastclock(stream);
+}
+
+/* Replays the matches from the leaf of the stream i up to the root, after
+ * its key has changed. Only the log2(n) nodes in the path are touched. */
+static void
+replay(struct player *player, int64_t i, struct player_key *key)
+{
+	struct player_key cand = *key;
+
+	struct player_key *tree = player->tree;
+	for (int64_t p = (player->nstreams + i) / 2; p >= 1; p /= 2) {
+		if (key_less(&tree[p], &cand)) {
+			struct player_key tmp = tree[p];
+			tree[p] = cand;
+			cand = tmp;
+		}
+	}
+
+	tree[0] = cand;
+}
+
+/* Finds the smallest key after the winner, which must be one of the
+ * streams that lost a match against the winner, so it is in its path. */
+static void
+find_runner(struct player *player)
+{
+	struct player_key *tree = player->tree;
+	struct player_key runner = { .done = 1 };
+
+	for (int64_t p = (player->nstreams + tree[0].index) / 2; p >= 1; p /= 2) {
+		if (key_less(&tree[p], &runner))
+			runner = tree[p];
+	}
+
+	player->runner = runner;
+	player->runner_valid = 1;
+}
+
+/* Updates the tree after the winner stream has been stepped */
+static void
+update_winner(struct player *player)
+{
+	int64_t i = player->tree[0].index;
+	struct player_key key;
+	stream_key(player, i, &key);
+
+	/* When a stream emits a run of events before any other stream,
+	 * it keeps winning all its matches, so we only need to update
+	 * its key. */
+	if (player->runner_valid && key_less(&key, &player->runner)) {
+		player->tree[0] = key;
+		return;
+	}
+
+	replay(player, i, &key);
+
+	/* Only look for the runner if the same stream won again, as it
+	 * may be starting a run. Otherwise we would need to walk the path
+	 * again for every event. */
+	if (player->tree[0].index == i)
+		find_runner(player);
 	else
-		return 0;
+		player->runner_valid = 0;
+}
+
+/* Plays the initial tournament among all the streams, leaving the loser of
+ * each match in the internal nodes. The leaf of the stream i is at the
+ * position n + i of a complete binary tree, so the parent of the node p is
+ * always p / 2. */
+static int
+build_tree(struct player *player)
+{
+	int64_t n = player->nstreams;
+
+	player->tree = calloc((size_t) n, sizeof(struct player_key));
+	if (player->tree == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	/* Winners of each node, only needed while building */
+	struct player_key *win = calloc((size_t) (2 * n), sizeof(struct player_key));
+	if (win == NULL) {
+		err("calloc failed:");
+		free(player->tree);
+		player->tree = NULL;
+		return -1;
+	}
+
+	for (int64_t i = 0; i < n; i++)
+		stream_key(player, i, &win[n + i]);
+
+	for (int64_t p = n - 1; p >= 1; p--) {
+		struct player_key *a = &win[2 * p];
+		struct player_key *b = &win[2 * p + 1];
+
+		if (key_less(a, b)) {
+			win[p] = *a;
+			player->tree[p] = *b;
+		} else {
+			win[p] = *b;
+			player->tree[p] = *a;
+		}
+	}
+
+	player->tree[0] = win[1];
+	free(win);
+
+	return 0;
 }
 
 static int
@@ -55,8 +154,6 @@ step_stream(struct player *player, struct stream *stream)
 		return ret;
 	}
 
-	heap_insert(&player->heap, &stream->hh, &stream_cmp);
-
 	player->nprocessed++;
 
 	return 0;
@@ -71,8 +168,8 @@ check_clock_gate(struct trace *trace)
 	int first = 1;
 	int ret = 0;
 
-	struct stream *stream;
-	DL_FOREACH(trace->streams, stream) {
+	for (long i = 0; i < trace->nstreams; i++) {
+		struct stream *stream = &trace->streams[i];
 		if (!stream->active)
 			continue;
 
@@ -109,16 +206,18 @@ player_init(struct player *player, struct trace *trace, int unsorted)
 {
 	memset(player, 0, sizeof(struct player));
 
-	heap_init(&player->heap);
-
 	player->first_event = 1;
 	player->stream = NULL;
 	player->trace = trace;
 	player->unsorted = unsorted;
 
+	player->nstreams = trace->nstreams;
+	player->streams = trace->streams;
+
 	/* Load initial streams and events */
-	struct stream *stream;
-	DL_FOREACH(trace->streams, stream) {
+	for (int64_t i = 0; i < player->nstreams; i++) {
+		struct stream *stream = &player->streams[i];
+
 		if (unsorted)
 			stream_allow_unsorted(stream);
 
@@ -139,6 +238,61 @@ player_init(struct player *player, struct trace *trace, int unsorted)
 		return -1;
 	}
 
+	if (player->nstreams > 0 && build_tree(player) != 0) {
+		err("build_tree failed");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Only plays the streams for which keep() returns non-zero. The clocks
+ * are still relative to the first event of the complete trace, so the
+ * emulation of each part produces the same times as the whole trace.
+ * Must be called after player_init() and before the first step. */
+int
+player_filter(struct player *player, player_keep_t keep, void *arg)
+{
+	if (player->nstreams == 0)
+		return 0;
+
+	if (player->stream != NULL || !player->first_event) {
+		err("cannot filter a player already started");
+		return -1;
+	}
+
+	player->skip = calloc((size_t) player->nstreams, sizeof(char));
+	if (player->skip == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	/* The winner holds the first clock among all the streams */
+	struct player_key *first = &player->tree[0];
+	if (!first->done) {
+		player->first_event = 0;
+		player->firstclock = first->clock;
+		player->lastclock = first->clock;
+	}
+
+	for (int64_t i = 0; i < player->nstreams; i++) {
+		struct stream *stream = &player->streams[i];
+		if (keep(stream, arg))
+			continue;
+
+		player->skip[i] = 1;
+		stream->active = 0;
+	}
+
+	free(player->tree);
+	player->tree = NULL;
+	player->runner_valid = 0;
+
+	if (build_tree(player) != 0) {
+		err("build_tree failed");
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -179,31 +333,35 @@ update_clocks(struct player *player, struct stream *stream)
 	return 0;
 }
 
-/* Returns -1 on error, +1 if there are no more events and 0 if next event
- * loaded properly */
-int
-player_step(struct player *player)
+static inline int
+step(struct player *player)
 {
-	/* Add the stream back if still active */
-	if (player->stream != NULL && step_stream(player, player->stream) < 0) {
-		err("step_stream() failed");
-		return -1;
+	/* No streams at all */
+	if (player->nstreams == 0)
+		return +1;
+
+	/* Step the last stream and update the tree with the new clock */
+	struct stream *last = player->stream;
+	if (last != NULL) {
+		if (step_stream(player, last) < 0) {
+			err("step_stream() failed");
+			return -1;
+		}
+
+		update_winner(player);
 	}
 
-	/* Extract the next stream based on the lastclock */
-	heap_node_t *node = heap_pop_max(&player->heap, stream_cmp);
+	/* The winner has the smallest clock of all the streams */
+	struct player_key *next = &player->tree[0];
 
 	/* No more streams */
-	if (node == NULL)
+	if (next->done) {
+		player->stream = NULL;
 		return +1;
-
-	struct stream *stream = heap_elem(node, struct stream, hh);
-
-	if (stream == NULL) {
-		err("heap_elem() returned NULL");
-		return -1;
 	}
 
+	struct stream *stream = &player->streams[next->index];
+
 	if (update_clocks(player, stream) != 0) {
 		err("update_clocks() failed");
 		return -1;
@@ -217,6 +375,34 @@ player_step(struct player *player)
 	return 0;
 }
 
+/* Returns -1 on error, +1 if there are no more events and 0 if next event
+ * loaded properly */
+int
+player_step(struct player *player)
+{
+	return step(player);
+}
+
+/* Plays up to n events, calling cb after each one is loaded. Returns -1 on
+ * error, +1 if there are no more events and 0 if all the n events were
+ * played. */
+int
+player_step_n(struct player *player, int64_t n, player_cb_t cb, void *arg)
+{
+	for (int64_t i = 0; i < n; i++) {
+		int ret = step(player);
+		if (ret != 0)
+			return ret;
+
+		if (cb(player, arg) != 0) {
+			err("callback failed");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 struct emu_ev *
 player_ev(struct player *player)
 {
@@ -232,13 +418,14 @@ player_stream(struct player *player)
 double
 player_progress(struct player *player)
 {
-	struct trace *trace = player->trace;
-	struct stream *stream;
 	int64_t sum_done = 0;
 	int64_t sum_total = 0;
-	DL_FOREACH(trace->streams, stream) {
+	for (int64_t i = 0; i < player->nstreams; i++) {
+		if (player->skip && player->skip[i])
+			continue;
+
 		int64_t done, total;
-		stream_progress(stream, &done, &total);
+		stream_progress(&player->streams[i], &done, &total);
 		sum_done += done;
 		sum_total += total;
 	}
@@ -1,4 +1,4 @@
-/* Copyright (c) 2021-2023 Barcelona Supercomputing Center (BSC)
+/* Copyright (c) 2021-2025 Barcelona Supercomputing Center (BSC)
  * SPDX-License-Identifier: GPL-3.0-or-later */
 
 #ifndef EMU_PLAYER_H
@@ -7,12 +7,40 @@
 #include <stdint.h>
 #include "common.h"
 #include "emu_ev.h"
-#include "heap.h"
+struct stream;
 struct trace;
+struct player;
+
+typedef int (*player_cb_t)(struct player *player, void *arg);
+typedef int (*player_keep_t)(struct stream *stream, void *arg);
+
+/* Key of one stream in the merge tree, ordered by clock and then by the
+ * stream index to break ties. Streams without more events are placed
+ * after all the others. */
+struct player_key {
+	int64_t clock;
+	int32_t index;
+	int32_t done;
+};
 
 struct player {
 	struct trace *trace;
-	heap_head_t heap;
+
+	/* Loser tree with one leaf per stream. The internal node p holds
+	 * the key of the stream that lost the match at p, while tree[0]
+	 * holds the overall winner (the next stream to be played). */
+	int64_t nstreams;
+	struct stream *streams;
+	struct player_key *tree;
+
+	/* Streams left out by player_filter(), or NULL to play all */
+	char *skip;
+
+	/* Smallest key among all the streams except the winner. While the
+	 * winner stays below it, the tree doesn't need to be replayed. */
+	struct player_key runner;
+	int runner_valid;
+
 	int64_t firstclock;
 	int64_t lastclock;
 	int64_t deltaclock;
@@ -24,7 +52,9 @@ struct player {
 };
 
 USE_RET int player_init(struct player *player, struct trace *trace, int unsorted);
+USE_RET int player_filter(struct player *player, player_keep_t keep, void *arg);
 USE_RET int player_step(struct player *player);
+USE_RET int player_step_n(struct player *player, int64_t n, player_cb_t cb, void *arg);
 USE_RET struct emu_ev *player_ev(struct player *player);
 USE_RET struct stream *player_stream(struct player *player);
 USE_RET double player_progress(struct player *player);
@@ -0,0 +1,337 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "profile.h"
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bay.h"
+#include "chan.h"
+#include "pv/pcf.h"
+#include "pv/prf.h"
+#include "pv/prv.h"
+#include "pv/prv_format.h"
+#include "value.h"
+
+static int
+bucket(int64_t duration)
+{
+	int b = 0;
+	for (uint64_t d = (uint64_t) duration; d > 1; d >>= 1)
+		b++;
+
+	return b;
+}
+
+struct profile_stat *
+profile_find(struct profile *prof, long row, long type, int64_t value)
+{
+	for (struct profile_chan *c = prof->chans; c; c = c->next) {
+		if (c->row != row || c->type != type)
+			continue;
+
+		long key = (long) value;
+		struct profile_stat *stat = NULL;
+		HASH_FIND_LONG(c->stats, &key, stat);
+		if (stat != NULL)
+			return stat;
+	}
+
+	return NULL;
+}
+
+/* Returns the number of durations in the bucket */
+int64_t
+profile_hist(struct profile_stat *stat, int i)
+{
+	if (stat->hist != NULL)
+		return stat->hist[i];
+
+	/* The only duration is the total */
+	if (stat->count == 1 && bucket(stat->total) == i)
+		return 1;
+
+	return 0;
+}
+
+static struct profile_stat *
+find_stat(struct profile *prof, struct profile_chan *c)
+{
+	for (int i = 0; i < 2; i++) {
+		struct profile_stat *stat = c->last[i];
+		if (stat != NULL && stat->value == c->value)
+			return stat;
+	}
+
+	long key = (long) c->value;
+	struct profile_stat *stat = NULL;
+	HASH_FIND_LONG(c->stats, &key, stat);
+	if (stat == NULL) {
+		stat = calloc(1, sizeof(struct profile_stat));
+		if (stat == NULL) {
+			err("calloc failed:");
+			return NULL;
+		}
+
+		stat->row = c->row;
+		stat->type = c->type;
+		stat->value = key;
+		HASH_ADD_LONG(c->stats, value, stat);
+		prof->nstats++;
+	}
+
+	c->last[1] = c->last[0];
+	c->last[0] = stat;
+
+	return stat;
+}
+
+/* Accounts the time spent in the current value of the channel */
+static int
+leave(struct profile *prof, struct profile_chan *c)
+{
+	if (c->value == 0)
+		return 0;
+
+	struct profile_stat *stat = find_stat(prof, c);
+	if (stat == NULL)
+		return -1;
+
+	if (stat->count == 1) {
+		stat->hist = calloc(PROFILE_NBUCKETS, sizeof(int64_t));
+		if (stat->hist == NULL) {
+			err("calloc failed:");
+			return -1;
+		}
+		stat->hist[bucket(stat->total)] = 1;
+	}
+
+	int64_t duration = prof->time - c->start;
+	stat->count++;
+	stat->total += duration;
+	if (stat->hist != NULL)
+		stat->hist[bucket(duration)]++;
+
+	return 0;
+}
+
+static int
+cb_profile(struct chan *chan, void *ptr)
+{
+	struct profile_chan *c = ptr;
+	struct value value;
+	if (chan_read(chan, &value) != 0) {
+		err("chan_read %s failed", chan->name);
+		return -1;
+	}
+
+	int64_t val = prv_value(&value, c->flags);
+
+	/* Duplicates only enter the value again with PRV_EMITDUP */
+	if (val == c->value && (~c->flags & PRV_EMITDUP))
+		return 0;
+
+	if (leave(c->prof, c) != 0)
+		return -1;
+
+	c->value = val;
+	c->start = c->prof->time;
+
+	return 0;
+}
+
+int
+profile_open(struct profile *prof, long nrows, const char *path,
+		struct pcf *pcf, struct prf *prf)
+{
+	memset(prof, 0, sizeof(struct profile));
+
+	prof->nrows = nrows;
+	prof->pcf = pcf;
+	prof->prf = prf;
+
+	prof->f = fopen(path, "w");
+	if (prof->f == NULL) {
+		err("cannot open file '%s' for writting:", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+int
+profile_register(struct profile *prof, long row, long type,
+		struct bay *bay, struct chan *chan, long flags)
+{
+	if (row < 0 || row >= prof->nrows) {
+		err("row %ld out of bounds", row);
+		return -1;
+	}
+
+	struct profile_chan *c = calloc(1, sizeof(struct profile_chan));
+	if (c == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	c->prof = prof;
+	c->chan = chan;
+	c->row = row;
+	c->type = type;
+	c->flags = flags;
+
+	if (bay_add_cb(bay, BAY_CB_EMIT, chan, cb_profile, c, 1) == NULL) {
+		err("bay_add_cb failed");
+		free(c);
+		return -1;
+	}
+
+	c->next = prof->chans;
+	prof->chans = c;
+
+	return 0;
+}
+
+int
+profile_advance(struct profile *prof, int64_t time)
+{
+	if (time < prof->time) {
+		err("cannot move to previous time");
+		return -1;
+	}
+
+	prof->time = time;
+	return 0;
+}
+
+static int
+cmp_stat(const void *a, const void *b)
+{
+	const struct profile_stat *sa = *(struct profile_stat *const *) a;
+	const struct profile_stat *sb = *(struct profile_stat *const *) b;
+
+	if (sa->row != sb->row)
+		return sa->row < sb->row ? -1 : 1;
+	if (sa->type != sb->type)
+		return sa->type < sb->type ? -1 : 1;
+	if (sa->value != sb->value)
+		return sa->value < sb->value ? -1 : 1;
+
+	return 0;
+}
+
+static char *
+put_field(char *p, int64_t v)
+{
+	p = prv_format_i64(p, v);
+	*p++ = '\t';
+	return p;
+}
+
+/* Formats the numbers without fprintf(), as there is one line per value
+ * of the identifiers */
+static void
+write_stat(struct profile *prof, struct profile_stat *stat)
+{
+	FILE *f = prof->f;
+	long row = stat->row;
+	long value = stat->value;
+
+	/* Up to 5 fields and 64 buckets of 20 digits */
+	char line[5 * 22 + PROFILE_NBUCKETS * 24];
+	char *p = line;
+	p = put_field(p, row + 1);
+	p = put_field(p, stat->type);
+	p = put_field(p, value);
+	p = put_field(p, stat->count);
+	p = put_field(p, stat->total);
+
+	for (int i = 0; i < PROFILE_NBUCKETS; i++) {
+		int64_t n = profile_hist(stat, i);
+		if (n == 0)
+			continue;
+		if (p[-1] != '\t')
+			*p++ = ',';
+		p = prv_format_i64(p, i);
+		*p++ = ':';
+		p = prv_format_i64(p, n);
+	}
+
+	fwrite(line, (size_t) (p - line), 1, f);
+
+	const char *rowlabel = "";
+	if (prof->prf != NULL && prof->prf->rows[row].set)
+		rowlabel = prof->prf->rows[row].label;
+
+	struct pcf_type *type = NULL;
+	struct pcf_value *pcfvalue = NULL;
+	if (prof->pcf != NULL)
+		type = pcf_find_type(prof->pcf, (int) stat->type);
+	if (type != NULL && value >= INT32_MIN && value <= INT32_MAX)
+		pcfvalue = pcf_find_value(type, (int) value);
+
+	fputc('\t', f);
+	fputs(rowlabel, f);
+	fputc('\t', f);
+	fputs(type ? type->label : "", f);
+	fputc('\t', f);
+	fputs(pcfvalue ? pcfvalue->label : "", f);
+	fputc('\n', f);
+}
+
+/* Accounts the current values and writes the report */
+int
+profile_close(struct profile *prof)
+{
+	int ret = 0;
+	for (struct profile_chan *c = prof->chans; c; c = c->next) {
+		if (leave(prof, c) != 0)
+			ret = -1;
+		c->value = 0;
+	}
+
+	size_t n = (size_t) prof->nstats;
+	struct profile_stat **stats = calloc(n + 1, sizeof(struct profile_stat *));
+	if (stats == NULL) {
+		err("calloc failed:");
+		fclose(prof->f);
+		return -1;
+	}
+
+	size_t i = 0;
+	struct profile_stat *stat, *tmp;
+	for (struct profile_chan *c = prof->chans; c; c = c->next) {
+		HASH_ITER(hh, c->stats, stat, tmp)
+			stats[i++] = stat;
+	}
+
+	qsort(stats, n, sizeof(struct profile_stat *), cmp_stat);
+
+	fprintf(prof->f, "# row\ttype\tvalue\tcount\ttotal\thistogram"
+			"\trow label\ttype label\tvalue label\n");
+
+	for (i = 0; i < n; i++)
+		write_stat(prof, stats[i]);
+
+	if (ferror(prof->f)) {
+		err("cannot write the profile");
+		ret = -1;
+	}
+
+	if (fclose(prof->f) != 0) {
+		err("fclose failed:");
+		ret = -1;
+	}
+
+	for (struct profile_chan *c = prof->chans; c; c = c->next) {
+		HASH_ITER(hh, c->stats, stat, tmp) {
+			HASH_DEL(c->stats, stat);
+			free(stat->hist);
+			free(stat);
+		}
+	}
+
+	free(stats);
+
+	return ret;
+}
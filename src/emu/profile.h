@@ -0,0 +1,79 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/* Aggregates the channels registered in a PRV file into a profile, as the
+ * Paraver histograms of states: for each row, type and value the number
+ * of times the value was entered, the total time spent in the value and
+ * a histogram of the durations. The zero value is not accounted, as it
+ * is not a state in the PRV. The report is written when closed.
+ *
+ * The bucket i of the histogram counts the durations in [2^i, 2^(i+1))
+ * nanoseconds, except the first one which also counts the durations of
+ * zero. Many values, as the identifiers, are only entered once, so the
+ * histogram is only allocated when a value is entered again.
+ *
+ * After a header line starting with #, the report has one line per row, type and value, sorted in that order,
+ * with the tab separated columns: row (starting at 1 as in the PRV), type,
+ * value, count, total time, histogram, and the labels of the row, type
+ * and value. The histogram is written as a comma separated list of
+ * bucket:count with the non-empty buckets. */
+
+#include <stdint.h>
+#include <stdio.h>
+#include "common.h"
+#include "uthash.h"
+struct bay;
+struct chan;
+struct pcf;
+struct prf;
+
+#define PROFILE_NBUCKETS 64
+
+struct profile_stat {
+	long row;
+	long type;
+	long value;
+	int64_t count;
+	int64_t total; /* In nanoseconds */
+	int64_t *hist; /* Of PROFILE_NBUCKETS, or NULL if count < 2 */
+	UT_hash_handle hh;
+};
+
+struct profile_chan {
+	struct profile *prof;
+	struct chan *chan;
+	long row;
+	long type;
+	long flags; /* As in prv_register() */
+	int64_t value; /* Current one, or zero */
+	int64_t start; /* Time the current value was entered */
+	struct profile_stat *stats; /* By value */
+	struct profile_stat *last[2]; /* Most channels alternate two values */
+	struct profile_chan *next;
+};
+
+struct profile {
+	FILE *f;
+	int64_t time;
+	long nrows;
+	struct pcf *pcf; /* For the labels of the report */
+	struct prf *prf;
+
+	struct profile_chan *chans;
+	long nstats;
+};
+
+USE_RET int profile_open(struct profile *prof, long nrows, const char *path,
+		struct pcf *pcf, struct prf *prf);
+USE_RET int profile_register(struct profile *prof, long row, long type,
+		struct bay *bay, struct chan *chan, long flags);
+USE_RET int profile_advance(struct profile *prof, int64_t time);
+USE_RET struct profile_stat *profile_find(struct profile *prof,
+		long row, long type, int64_t value);
+USE_RET int64_t profile_hist(struct profile_stat *stat, int bucket);
+USE_RET int profile_close(struct profile *prof);
+
+#endif /* PROFILE_H */
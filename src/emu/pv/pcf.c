@@ -117,12 +117,16 @@ write_types(struct pcf *pcf)
 		write_type(pcf->f, t);
 }
 
-/** Open the given PCF file and create the default events. */
+/** Open the given PCF file and create the default events. With a NULL
+ * path the types are only kept in memory. */
 int
 pcf_open(struct pcf *pcf, char *path)
 {
 	memset(pcf, 0, sizeof(*pcf));
 
+	if (path == NULL)
+		return 0;
+
 	pcf->f = fopen(path, "w");
 
 	if (pcf->f == NULL) {
@@ -225,10 +229,107 @@ pcf_add_value(struct pcf_type *type, int value, const char *label)
 	return pcfvalue;
 }
 
+/** Saves the types and values in a simple format that can be read back by
+ * pcf_merge(), so the emulation workers can send to the main process the
+ * values they have defined. The PCF file is left untouched. */
+int
+pcf_save(struct pcf *pcf, const char *path)
+{
+	FILE *f = fopen(path, "w");
+
+	if (f == NULL) {
+		err("cannot open PCF part '%s':", path);
+		return -1;
+	}
+
+	for (struct pcf_type *t = pcf->types; t != NULL; t = t->hh.next) {
+		fprintf(f, "T %d %s\n", t->id, t->label);
+		for (struct pcf_value *v = t->values; v != NULL; v = v->hh.next)
+			fprintf(f, "V %d %d %s\n", t->id, v->value, v->label);
+	}
+
+	if (fclose(f) != 0) {
+		err("cannot close PCF part '%s':", path);
+		return -1;
+	}
+
+	return 0;
+}
+
+/** Adds the types and values saved by pcf_save() in the given path which
+ * are not already defined, and removes the file. */
+int
+pcf_merge(struct pcf *pcf, const char *path)
+{
+	FILE *f = fopen(path, "r");
+
+	if (f == NULL) {
+		err("cannot open PCF part '%s':", path);
+		return -1;
+	}
+
+	int ret = -1;
+	char *line = NULL;
+	size_t size = 0;
+	ssize_t len;
+	while ((len = getline(&line, &size, f)) >= 0) {
+		if (len > 0 && line[len - 1] == '\n')
+			line[len - 1] = '\0';
+
+		int type_id, value, n = 0;
+		if (sscanf(line, "T %d %n", &type_id, &n) == 1 && n > 0) {
+			if (pcf_find_type(pcf, type_id) != NULL)
+				continue;
+
+			if (pcf_add_type(pcf, type_id, line + n) == NULL) {
+				err("pcf_add_type failed");
+				goto out;
+			}
+		} else if (sscanf(line, "V %d %d %n", &type_id, &value, &n) == 2 && n > 0) {
+			struct pcf_type *t = pcf_find_type(pcf, type_id);
+			if (t == NULL) {
+				err("PCF part '%s' has value for unknown type %d",
+						path, type_id);
+				goto out;
+			}
+
+			if (pcf_find_value(t, value) != NULL)
+				continue;
+
+			if (pcf_add_value(t, value, line + n) == NULL) {
+				err("pcf_add_value failed");
+				goto out;
+			}
+		} else {
+			err("malformed line in PCF part '%s': %s", path, line);
+			goto out;
+		}
+	}
+
+	if (ferror(f)) {
+		err("cannot read PCF part '%s':", path);
+		goto out;
+	}
+
+	ret = 0;
+
+out:
+	free(line);
+	fclose(f);
+
+	if (ret == 0 && remove(path) != 0)
+		warn("cannot remove PCF part '%s':", path);
+
+	return ret;
+}
+
 /** Writes the defined event and values to the PCF file and closes the file. */
 int
 pcf_close(struct pcf *pcf)
 {
+	if (pcf->f == NULL)
+		return 0;
+
 	write_header(pcf->f);
 	write_colors(pcf->f, pcf_palette, pcf_palette_len);
 	write_types(pcf);
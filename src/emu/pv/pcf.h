@@ -45,6 +45,8 @@ struct pcf_value_label {
 
 USE_RET int pcf_open(struct pcf *pcf, char *path);
 USE_RET int pcf_close(struct pcf *pcf);
+USE_RET int pcf_save(struct pcf *pcf, const char *path);
+USE_RET int pcf_merge(struct pcf *pcf, const char *path);
 
 USE_RET struct pcf_type *pcf_find_type(struct pcf *pcf, int type_id);
 USE_RET struct pcf_type *pcf_add_type(struct pcf *pcf, int type_id, const char *label);
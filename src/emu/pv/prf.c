@@ -12,9 +12,11 @@ prf_open(struct prf *prf, const char *path, long nrows)
 {
 	memset(prf, 0, sizeof(*prf));
 
-	prf->f = fopen(path, "w");
+	/* Only keep the labels in memory */
+	if (path != NULL)
+		prf->f = fopen(path, "w");
 
-	if (prf->f == NULL) {
+	if (path != NULL && prf->f == NULL) {
 		err("cannot open ROW file '%s':", path);
 		return -1;
 	}
@@ -67,6 +69,9 @@ prf_close(struct prf *prf)
 	}
 
 	FILE *f = prf->f;
+	if (f == NULL)
+		return 0;
+
 	fprintf(f, "LEVEL NODE SIZE 1\n");
 	fprintf(f, "hostname\n");
 	fprintf(f, "\n");
@@ -2,34 +2,104 @@
  * SPDX-License-Identifier: GPL-3.0-or-later */
 
 #include "prv.h"
+#include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "bay.h"
 #include "chan.h"
+#include "columns.h"
 #include "common.h"
-
-static void
-write_header(FILE *f, long long duration, int nrows)
+#include "perfetto.h"
+#include "profile.h"
+#include "prv_bin.h"
+#include "prv_format.h"
+#include "spsc.h"
+#include "varint.h"
+
+void
+prv_write_header(FILE *f, int64_t duration, long nrows)
 {
-	fprintf(f, "#Paraver (19/01/38 at 03:14):%020lld_ns:0:1:1(%d:1)\n",
+	fprintf(f, "#Paraver (19/01/38 at 03:14):%020"PRIi64"_ns:0:1:1(%ld:1)\n",
 			duration, nrows);
 }
 
-int
-prv_open_file(struct prv *prv, long nrows, FILE *file)
+static int
+write_bin_header(FILE *f, int64_t duration, long nrows)
 {
-	memset(prv, 0, sizeof(struct prv));
+	struct prv_bin_header hdr;
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, PRV_BIN_MAGIC, sizeof(hdr.magic));
+	hdr.version = PRV_BIN_VERSION;
+	hdr.nrows = nrows;
+	hdr.duration = duration;
+
+	if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+		err("cannot write binary PRV header:");
+		return -1;
+	}
 
-	prv->nrows = nrows;
+	return 0;
+}
+
+/* Writes the header in the stdio buffer to the file, so the lines can be
+ * written after it without stdio */
+static int
+start_file(struct prv *prv, FILE *file)
+{
 	prv->file = file;
 
 	/* Write fake header to allocate the space */
-	write_header(file, 0LL, (int) nrows);
+	if (prv->binary) {
+		if (write_bin_header(file, 0, prv->nrows) != 0)
+			return -1;
+
+		/* Leave room for the header of the first block */
+		prv->len = sizeof(struct prv_bin_block);
+		prv->block_time = prv->last_time;
+	} else {
+		prv_write_header(file, 0, prv->nrows);
+	}
+
+	if (fflush(file) != 0) {
+		err("fflush failed:");
+		return -1;
+	}
+
+	prv->fd = fileno(file);
 
 	return 0;
 }
 
+static int
+open_file(struct prv *prv, long nrows, FILE *file, int binary)
+{
+	memset(prv, 0, sizeof(struct prv));
+
+	prv->nrows = nrows;
+	prv->binary = binary;
+
+	prv->buf = malloc(PRV_BUFSIZE);
+	if (prv->buf == NULL) {
+		err("malloc failed:");
+		return -1;
+	}
+
+	return start_file(prv, file);
+}
+
+int
+prv_open_file(struct prv *prv, long nrows, FILE *file)
+{
+	return open_file(prv, nrows, file, 0);
+}
+
 int
 prv_open(struct prv *prv, long nrows, const char *path)
 {
@@ -40,17 +110,147 @@ prv_open(struct prv *prv, long nrows, const char *path)
 		return -1;
 	}
 
-	return prv_open_file(prv, nrows, f);
+	return open_file(prv, nrows, f, 0);
+}
+
+/* Opens a binary log in the path instead of a PRV file, see prv_bin.h */
+int
+prv_open_bin(struct prv *prv, long nrows, const char *path)
+{
+	FILE *f = fopen(path, "w");
+
+	if (f == NULL) {
+		err("cannot open file '%s' for writting:", path);
+		return -1;
+	}
+
+	return open_file(prv, nrows, f, 1);
+}
+
+/* Opens a PRV without file, where the channels are only registered in the
+ * exporters */
+int
+prv_open_null(struct prv *prv, long nrows)
+{
+	memset(prv, 0, sizeof(struct prv));
+
+	prv->nrows = nrows;
+	prv->discard = 1;
+
+	return 0;
+}
+
+/* Writes the buffered lines as a block of the binary log */
+static int
+flush_block(struct prv *prv)
+{
+	size_t hdrsize = sizeof(struct prv_bin_block);
+	if (prv->len == hdrsize)
+		return 0;
+
+	struct prv_bin_block blk;
+	blk.size = prv->len - hdrsize;
+	blk.time = prv->block_time;
+	memcpy(prv->buf, &blk, hdrsize);
+
+	if (write_all(prv->fd, prv->buf, prv->len) != 0) {
+		err("cannot write binary PRV block");
+		return -1;
+	}
+
+	prv->len = hdrsize;
+	prv->block_time = prv->last_time;
+
+	return 0;
+}
+
+/* Writes the buffered lines to the file */
+int
+prv_flush(struct prv *prv)
+{
+	if (prv->binary)
+		return flush_block(prv);
+
+	if (prv->len == 0)
+		return 0;
+
+	if (write_all(prv->fd, prv->buf, prv->len) != 0) {
+		err("cannot write PRV lines");
+		return -1;
+	}
+
+	prv->written += (int64_t) prv->len;
+	prv->len = 0;
+
+	return 0;
+}
+
+/* Appends the bytes to the buffer, writing them directly if they don't
+ * fit in it */
+static int
+append(struct prv *prv, const char *data, size_t len)
+{
+	if (PRV_BUFSIZE - prv->len < len && prv_flush(prv) != 0)
+		return -1;
+
+	if (len >= PRV_BUFSIZE) {
+		prv->written += (int64_t) len;
+		return write_all(prv->fd, data, len);
+	}
+
+	memcpy(prv->buf + prv->len, data, len);
+	prv->len += len;
+
+	return 0;
 }
 
 int
 prv_close(struct prv *prv)
 {
+	int ret = 0;
+	if (prv->rows != NULL && prv_commit(prv) != 0) {
+		err("prv_commit failed");
+		ret = -1;
+	}
+
+	if (prv->discard)
+		goto out;
+
+	if (prv_flush(prv) != 0) {
+		err("prv_flush failed");
+		ret = -1;
+	}
+
 	/* Fix the header with the current duration */
 	fseek(prv->file, 0, SEEK_SET);
-	write_header(prv->file, prv->time, (int) prv->nrows);
-	fclose(prv->file);
-	return 0;
+	if (prv->binary) {
+		if (write_bin_header(prv->file, prv->time, prv->nrows) != 0)
+			ret = -1;
+	} else {
+		prv_write_header(prv->file, prv->time, prv->nrows);
+	}
+
+	if (fclose(prv->file) != 0) {
+		err("fclose failed:");
+		ret = -1;
+	}
+
+out:
+	free(prv->buf);
+	free(prv->shard_base);
+	prv->buf = NULL;
+	prv->shard_base = NULL;
+
+	if (prv->rows != NULL) {
+		for (long i = 0; i < prv->nrows; i++)
+			free(prv->rows[i].ev);
+		free(prv->rows);
+		free(prv->held);
+		prv->rows = NULL;
+		prv->held = NULL;
+	}
+
+	return ret;
 }
 
 static long
@@ -68,11 +268,222 @@ find_prv_chan(struct prv *prv, long id)
 	return rchan;
 }
 
+/* Starts a line with the row and time, followed by one or more events */
+static int
+begin_line(struct prv *prv, long row_base1, int64_t time)
+{
+	if (PRV_BUFSIZE - prv->len < PRV_MAXLINE && prv_flush(prv) != 0)
+		return -1;
+
+	char *p = prv->buf + prv->len;
+
+	if (prv->binary) {
+		if (time < prv->last_time) {
+			err("cannot write line before the previous one");
+			return -1;
+		}
+		p = varint_put_u64(p, (uint64_t) row_base1);
+		p = varint_put_u64(p, (uint64_t) (time - prv->last_time));
+		prv->last_time = time;
+		prv->line_events = 0;
+		prv->len = (size_t) (p - prv->buf);
+		return 0;
+	}
+
+	memcpy(p, "2:0:1:1:", 8);
+	p = prv_format_i64(p + 8, row_base1);
+	*p++ = ':';
+	p = prv_format_i64(p, time);
+
+	prv->len = (size_t) (p - prv->buf);
+
+	return 0;
+}
+
+static int
+add_event(struct prv *prv, int64_t type, int64_t value)
+{
+	if (PRV_BUFSIZE - prv->len < PRV_MAXEVENT && prv_flush(prv) != 0)
+		return -1;
+
+	char *p = prv->buf + prv->len;
+
+	if (prv->binary) {
+		/* The rest of events of the line follow a zero row */
+		if (prv->line_events++ > 0)
+			*p++ = 0;
+		p = varint_put_i64(p, type);
+		p = varint_put_i64(p, value);
+		prv->len = (size_t) (p - prv->buf);
+		return 0;
+	}
+
+	*p++ = ':';
+	p = prv_format_i64(p, type);
+	*p++ = ':';
+	p = prv_format_i64(p, value);
+
+	prv->len = (size_t) (p - prv->buf);
+
+	return 0;
+}
+
 static void
+end_line(struct prv *prv)
+{
+	/* Always room for the newline after begin_line() or add_event() */
+	if (!prv->binary)
+		prv->buf[prv->len++] = '\n';
+}
+
+/* Formats the line as "2:0:1:1:%ld:%ld:%ld:%ld\n" in the buffer */
+static int
+format_line(struct prv *prv, long row_base1, int64_t time,
+		int64_t type, int64_t value)
+{
+	if (begin_line(prv, row_base1, time) != 0)
+		return -1;
+
+	if (add_event(prv, type, value) != 0)
+		return -1;
+
+	end_line(prv);
+
+	return 0;
+}
+
+/* Writes an event queued by queue_event(), called by the writer thread.
+ * The events with the more flag continue in the next record. */
+int
+prv_write_rec(const struct prv_rec *rec)
+{
+	struct prv *prv = rec->prv;
+
+	if (!prv->line_open && begin_line(prv, rec->row_base1, rec->time) != 0)
+		return -1;
+
+	if (add_event(prv, rec->type, rec->value) != 0)
+		return -1;
+
+	prv->line_open = rec->more;
+	if (!rec->more)
+		end_line(prv);
+
+	return 0;
+}
+
+static void
+queue_event(struct prv *prv, long row_base1, int64_t type, int64_t value,
+		int more)
+{
+	struct prv_rec *rec;
+	while ((rec = spsc_claim(prv->queue)) == NULL)
+		sched_yield();
+
+	rec->prv = prv;
+	rec->row_base1 = row_base1;
+	rec->time = prv->time;
+	rec->type = type;
+	rec->value = value;
+	rec->more = more;
+	spsc_push(prv->queue);
+}
+
+/* Keeps the event until prv_commit() writes it with the rest of events
+ * of the same row */
+static int
+hold_event(struct prv *prv, long row_base1, int64_t type, int64_t value)
+{
+	struct prv_row *row = &prv->rows[row_base1 - 1];
+
+	if (row->n >= row->max) {
+		long n = row->max == 0 ? 4 : row->max * 2;
+		struct prv_ev *ev = realloc(row->ev, (size_t) n * sizeof(struct prv_ev));
+		if (ev == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		row->ev = ev;
+		row->max = n;
+	}
+
+	if (row->n == 0)
+		prv->held[prv->nheld++] = row_base1;
+
+	row->ev[row->n].type = type;
+	row->ev[row->n].value = value;
+	row->n++;
+
+	return 0;
+}
+
+static int
 write_line(struct prv *prv, long row_base1, int64_t type, int64_t value)
 {
-	fprintf(prv->file, "2:0:1:1:%ld:%"PRIi64":%"PRIi64":%"PRIi64"\n",
-			row_base1, prv->time, type, value);
+	if (prv->rows != NULL)
+		return hold_event(prv, row_base1, type, value);
+
+	if (prv->queue == NULL)
+		return format_line(prv, row_base1, prv->time, type, value);
+
+	queue_event(prv, row_base1, type, value, 0);
+
+	return 0;
+}
+
+/* Writes the events held since the last commit, with one line per row in
+ * the order in which the rows were first written */
+int
+prv_commit(struct prv *prv)
+{
+	for (long i = 0; i < prv->nheld; i++) {
+		long row_base1 = prv->held[i];
+		struct prv_row *row = &prv->rows[row_base1 - 1];
+
+		if (prv->queue != NULL) {
+			for (long j = 0; j < row->n; j++) {
+				queue_event(prv, row_base1, row->ev[j].type,
+						row->ev[j].value, j + 1 < row->n);
+			}
+			row->n = 0;
+			continue;
+		}
+
+		if (begin_line(prv, row_base1, prv->time) != 0)
+			return -1;
+
+		for (long j = 0; j < row->n; j++) {
+			if (add_event(prv, row->ev[j].type, row->ev[j].value) != 0)
+				return -1;
+		}
+
+		end_line(prv);
+		row->n = 0;
+	}
+
+	prv->nheld = 0;
+
+	return 0;
+}
+
+/* Gathers the events of the same row emitted until the next call to
+ * prv_commit() in a single line */
+int
+prv_coalesce(struct prv *prv)
+{
+	prv->rows = calloc((size_t) prv->nrows, sizeof(struct prv_row));
+	if (prv->rows == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	prv->held = calloc((size_t) prv->nrows, sizeof(long));
+	if (prv->held == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	return 0;
 }
 
 static int
@@ -134,7 +545,10 @@ emit(struct prv *prv, struct prv_chan *rchan)
 		return -1;
 	}
 
-	write_line(prv, rchan->row_base1, rchan->type, val);
+	if (write_line(prv, rchan->row_base1, rchan->type, val) != 0) {
+		err("cannot write line for channel %s", chan->name);
+		return -1;
+	}
 
 	dbg("written %s for chan %s", value_str(value), chan->name);
 
@@ -204,17 +618,136 @@ prv_register(struct prv *prv, long row, long type, struct bay *bay, struct chan
 	rchan->flags = flags;
 
 	/* Add emit callback */
-	if (bay_add_cb(bay, BAY_CB_EMIT, chan, cb_prv, rchan, 1) == NULL) {
+	if (!prv->discard && bay_add_cb(bay, BAY_CB_EMIT, chan, cb_prv, rchan, 1) == NULL) {
 		err("bay_add_cb failed");
 		return -1;
 	}
 
+	if (prv->perfetto != NULL && perfetto_register(prv->perfetto,
+				row, type, bay, chan, flags) != 0) {
+		err("perfetto_register failed");
+		return -1;
+	}
+
+	if (prv->columns != NULL && columns_register(prv->columns,
+				row, type, bay, chan, flags) != 0) {
+		err("columns_register failed");
+		return -1;
+	}
+
+	if (prv->profile != NULL && profile_register(prv->profile,
+				row, type, bay, chan, flags) != 0) {
+		err("profile_register failed");
+		return -1;
+	}
+
+	/* Drop the updates that all the emit callbacks skip */
+	enum bay_filter filter = BAY_FILTER_NONE;
+	if (flags & PRV_SKIPDUP)
+		filter = BAY_FILTER_SAME;
+	else if (flags & PRV_SKIPDUPNULL)
+		filter = BAY_FILTER_NULL;
+
+	if (bay_filter(bay, chan, filter) != 0) {
+		err("bay_filter failed");
+		return -1;
+	}
+
 	/* Add to hash table */
 	HASH_ADD_LONG(prv->channels, id, rchan);
 
 	return 0;
 }
 
+static int
+shard_path(struct prv *prv, long n, char *path)
+{
+	if (snprintf(path, PATH_MAX, "%s.%ld.prv", prv->shard_base, n) >= PATH_MAX) {
+		err("snprintf failed: path too long");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Closes the current file, with the time as duration, and continues the
+ * lines in the next shard */
+static int
+next_shard(struct prv *prv, int64_t time)
+{
+	char path[PATH_MAX];
+	if (shard_path(prv, prv->nshards, path) != 0)
+		return -1;
+
+	FILE *f = fopen(path, "w");
+	if (f == NULL) {
+		err("cannot open file '%s' for writting:", path);
+		return -1;
+	}
+
+	if (prv->rows != NULL && prv_commit(prv) != 0) {
+		err("prv_commit failed");
+		fclose(f);
+		return -1;
+	}
+
+	if (prv_flush(prv) != 0) {
+		err("prv_flush failed");
+		fclose(f);
+		return -1;
+	}
+
+	fseek(prv->file, 0, SEEK_SET);
+	prv_write_header(prv->file, time, prv->nrows);
+	if (fclose(prv->file) != 0) {
+		err("fclose failed:");
+		fclose(f);
+		return -1;
+	}
+
+	prv->nshards++;
+	prv->written = 0;
+
+	return start_file(prv, f);
+}
+
+/* Writes the current value of the channels at the beginning of the shard,
+ * as the previous lines are in other files */
+static int
+write_values(struct prv *prv)
+{
+	for (struct prv_chan *rchan = prv->channels; rchan; rchan = rchan->hh.next) {
+		/* The events are not states that continue */
+		if (rchan->flags & PRV_EMITDUP)
+			continue;
+
+		struct value value;
+		if (chan_read(rchan->chan, &value) != 0) {
+			err("chan_read %s failed", rchan->chan->name);
+			return -1;
+		}
+
+		int64_t val = prv_value(&value, rchan->flags);
+		if (val != 0 && write_line(prv, rchan->row_base1, rchan->type, val) != 0)
+			return -1;
+	}
+
+	return 0;
+}
+
+static int
+shard_full(struct prv *prv, int64_t time)
+{
+	if (time >= prv->shard_end)
+		return 1;
+
+	/* The lines of the same time stay in the same shard */
+	if (prv->shard_bytes == 0 || time == prv->time)
+		return 0;
+
+	return prv->written + (int64_t) prv->len >= prv->shard_bytes;
+}
+
 int
 prv_advance(struct prv *prv, int64_t time)
 {
@@ -223,6 +756,247 @@ prv_advance(struct prv *prv, int64_t time)
 		return -1;
 	}
 
+	if (prv->shard_base == NULL || !shard_full(prv, time)) {
+		prv->time = time;
+		return 0;
+	}
+
+	if (next_shard(prv, time) != 0) {
+		err("cannot begin shard %ld", prv->nshards);
+		return -1;
+	}
+
+	if (prv->shard_ns > 0)
+		prv->shard_end = (time / prv->shard_ns + 1) * prv->shard_ns;
+
 	prv->time = time;
+	return write_values(prv);
+}
+
+/* Continues writing the PRV lines in shards named <base>.<n>.prv, beginning
+ * the next one every ns of trace time or when the shard has the given bytes,
+ * unless zero. Each shard has its own header and begins with the current
+ * values of the channels, so it can be opened alone. */
+int
+prv_shard(struct prv *prv, const char *base, int64_t ns, int64_t bytes)
+{
+	if (prv->binary || prv->discard || prv->queue != NULL) {
+		err("only PRV files written by the emulator can be sharded");
+		return -1;
+	}
+
+	prv->shard_base = strdup(base);
+	if (prv->shard_base == NULL) {
+		err("strdup failed:");
+		return -1;
+	}
+
+	prv->shard_ns = ns;
+	prv->shard_bytes = bytes;
+	prv->shard_end = ns > 0 ? (prv->time / ns + 1) * ns : INT64_MAX;
+
+	return next_shard(prv, prv->time);
+}
+
+/* Continues writing the PRV lines into a new file in the given path, which
+ * is closed with prv_close() like any other PRV file. Each emulation worker
+ * writes its own part this way, which are later merged by prv_merge(). */
+int
+prv_split(struct prv *prv, const char *path)
+{
+	if (prv->binary) {
+		err("cannot split a binary PRV log");
+		return -1;
+	}
+
+	FILE *f = fopen(path, "w");
+
+	if (f == NULL) {
+		err("cannot open file '%s' for writting:", path);
+		return -1;
+	}
+
+	/* The lines already written stay in the previous file */
+	if (prv_flush(prv) != 0 || fclose(prv->file) != 0) {
+		err("cannot close previous PRV file:");
+		fclose(f);
+		return -1;
+	}
+
+	return start_file(prv, f);
+}
+
+struct part {
+	const char *path;
+	char *buf;
+	size_t size;
+	const char *line; /* Current line, NULL at the end */
+	const char *next; /* Following line */
+	int64_t time;
+};
+
+/* Moves to the next line of the part, parsing its time */
+static int
+part_next(struct part *p)
+{
+	const char *end = p->buf + p->size;
+	const char *line = p->next;
+
+	if (line >= end) {
+		p->line = NULL;
+		p->time = INT64_MAX;
+		return 0;
+	}
+
+	const char *nl = memchr(line, '\n', (size_t) (end - line));
+	p->line = line;
+	p->next = nl ? nl + 1 : end;
+
+	/* The time is the sixth field: 2:cpu:appl:task:thread:time:... */
+	const char *s = line;
+	for (int i = 0; i < 5; i++) {
+		s = memchr(s, ':', (size_t) (p->next - s));
+		if (s == NULL) {
+			err("malformed line in PRV part '%s'", p->path);
+			return -1;
+		}
+		s++;
+	}
+
+	int64_t t = 0;
+	for (; s < p->next && *s >= '0' && *s <= '9'; s++)
+		t = t * 10 + (*s - '0');
+
+	p->time = t;
+
 	return 0;
 }
+
+static int
+part_open(struct part *p, const char *path, int64_t *duration)
+{
+	p->path = path;
+
+	int fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		err("cannot open PRV part '%s':", path);
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		err("fstat failed for PRV part '%s':", path);
+		close(fd);
+		return -1;
+	}
+
+	p->size = (size_t) st.st_size;
+	if (p->size > 0) {
+		p->buf = mmap(NULL, p->size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p->buf == MAP_FAILED) {
+			err("mmap failed for PRV part '%s':", path);
+			p->buf = NULL;
+			close(fd);
+			return -1;
+		}
+		posix_madvise(p->buf, p->size, POSIX_MADV_SEQUENTIAL);
+	}
+	close(fd);
+
+	/* The header holds the time reached by the worker */
+	const char *end = p->buf + p->size;
+	const char *nl = p->buf ? memchr(p->buf, '\n', p->size) : NULL;
+	if (nl == NULL || nl - p->buf < 3) {
+		err("missing header in PRV part '%s'", path);
+		return -1;
+	}
+
+	const char *s = p->buf;
+	while (s + 1 < nl && !(s[0] == ')' && s[1] == ':'))
+		s++;
+
+	if (s + 1 >= nl) {
+		err("malformed header in PRV part '%s'", path);
+		return -1;
+	}
+
+	*duration = 0;
+	for (s += 2; s < end && *s >= '0' && *s <= '9'; s++)
+		*duration = *duration * 10 + (*s - '0');
+
+	p->next = nl + 1;
+
+	return part_next(p);
+}
+
+/* Appends the lines of the PRV files written by each worker after
+ * prv_split(), sorted by time. Lines with the same time are taken from the
+ * lower parts first, keeping the order of each part. The duration is
+ * updated to the maximum reached by any part and the parts are removed. */
+int
+prv_merge(struct prv *prv, long nparts, char *const paths[])
+{
+	struct part *parts = calloc((size_t) nparts, sizeof(struct part));
+	if (parts == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	int ret = -1;
+	for (long i = 0; i < nparts; i++) {
+		int64_t duration;
+		if (part_open(&parts[i], paths[i], &duration) != 0)
+			goto out;
+
+		if (duration > prv->time)
+			prv->time = duration;
+	}
+
+	while (1) {
+		struct part *best = &parts[0];
+		struct part *second = NULL;
+		for (long i = 1; i < nparts; i++) {
+			struct part *p = &parts[i];
+			if (p->time < best->time) {
+				second = best;
+				best = p;
+			} else if (second == NULL || p->time < second->time) {
+				second = p;
+			}
+		}
+
+		if (best->line == NULL)
+			break;
+
+		/* Copy the lines of the best part in one go while they are
+		 * not after the lines of any other part */
+		int64_t limit = second ? second->time : INT64_MAX;
+		const char *run = best->line;
+		int ties = second && best > second;
+		do {
+			if (part_next(best) != 0)
+				goto out;
+		} while (best->line != NULL && (best->time < limit
+				|| (best->time == limit && !ties)));
+
+		size_t len = (size_t) ((best->line ? best->line : best->buf + best->size) - run);
+		if (append(prv, run, len) != 0) {
+			err("cannot write merged PRV lines");
+			goto out;
+		}
+	}
+
+	ret = 0;
+
+out:
+	for (long i = 0; i < nparts; i++) {
+		struct part *p = &parts[i];
+		if (p->buf != NULL)
+			munmap(p->buf, p->size);
+		if (p->path != NULL && ret == 0 && remove(p->path) != 0)
+			warn("cannot remove PRV part '%s':", p->path);
+	}
+	free(parts);
+
+	return ret;
+}
@@ -11,6 +11,10 @@
 #include "value.h"
 struct bay;
 struct chan;
+struct columns;
+struct perfetto;
+struct profile;
+struct spsc;
 
 enum prv_flags {
 	PRV_EMITDUP     = 1<<0, /* Emit duplicates (no error, emit) */
@@ -32,17 +36,104 @@ struct prv_chan {
 	UT_hash_handle hh; /* Indexed by chan->name */
 };
 
+/* Size of the buffer of lines of each PRV file */
+#define PRV_BUFSIZE (4 * 1024 * 1024)
+
+/* Longest line, with four numbers of up to 20 characters */
+#define PRV_MAXLINE 128
+
+/* Longest type and value pair */
+#define PRV_MAXEVENT 48
+
+struct prv_ev {
+	int64_t type;
+	int64_t value;
+};
+
+/* Events of a row waiting for prv_commit() */
+struct prv_row {
+	long n;
+	long max;
+	struct prv_ev *ev;
+};
+
 struct prv {
-	FILE *file;
+	FILE *file; /* Only to write the header */
+	int fd;
+	char *buf;
+	size_t len;
+
+	/* Opened with prv_open_null(), without file */
+	int discard;
+
+	/* Writing the binary log with prv_open_bin() */
+	int binary;
+	int64_t last_time;  /* Of the last line */
+	int64_t block_time; /* Of the line before the current block */
+	long line_events;   /* Events in the current line */
+
 	int64_t time;
 	long nrows;
 	struct prv_chan *channels;
+
+	/* Also export the registered channels, or NULL */
+	struct perfetto *perfetto;
+	struct columns *columns;
+	struct profile *profile;
+
+	/* Splitting the lines in shards with prv_shard() */
+	char *shard_base;    /* Path of the shards without the number */
+	int64_t shard_ns;    /* Trace time of each shard, or zero */
+	int64_t shard_bytes; /* Size of each shard, or zero */
+	int64_t shard_end;   /* Time of the next shard */
+	int64_t written;     /* Bytes written in the current shard */
+	long nshards;        /* Shards begun */
+
+	/* Queue to the writer thread, or NULL to write the lines here */
+	struct spsc *queue;
+	int line_open; /* Only used by the writer thread */
+
+	/* With prv_coalesce(), the held events of each row and the
+	 * rows with events in the order they were held */
+	struct prv_row *rows;
+	long *held;
+	long nheld;
+};
+
+/* One line queued to the writer thread */
+struct prv_rec {
+	struct prv *prv;
+	long row_base1;
+	int64_t time;
+	int64_t type;
+	int64_t value;
+	int more; /* Next record continues the same line */
 };
 
+/* Value of the channel as written in the PRV, zero if null */
+static inline int64_t
+prv_value(const struct value *value, long flags)
+{
+	if (value->type != VALUE_INT64)
+		return 0;
+
+	return (flags & PRV_NEXT) ? value->i + 1 : value->i;
+}
+
 USE_RET int prv_open(struct prv *prv, long nrows, const char *path);
 USE_RET int prv_open_file(struct prv *prv, long nrows, FILE *file);
+USE_RET int prv_open_bin(struct prv *prv, long nrows, const char *path);
+USE_RET int prv_open_null(struct prv *prv, long nrows);
+        void prv_write_header(FILE *f, int64_t duration, long nrows);
 USE_RET int prv_register(struct prv *prv, long row, long type, struct bay *bay, struct chan *chan, long flags);
 USE_RET int prv_advance(struct prv *prv, int64_t time);
 USE_RET int prv_close(struct prv *prv);
+USE_RET int prv_write_rec(const struct prv_rec *rec);
+USE_RET int prv_flush(struct prv *prv);
+USE_RET int prv_coalesce(struct prv *prv);
+USE_RET int prv_commit(struct prv *prv);
+USE_RET int prv_split(struct prv *prv, const char *path);
+USE_RET int prv_shard(struct prv *prv, const char *base, int64_t ns, int64_t bytes);
+USE_RET int prv_merge(struct prv *prv, long nparts, char *const paths[]);
 
 #endif /* PRV_H */
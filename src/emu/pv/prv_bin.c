@@ -0,0 +1,359 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "prv_bin.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "prv.h"
+#include "prv_format.h"
+
+struct block {
+	const char *data;
+	size_t size;
+	int64_t time;
+	int first; /* Holds the first line of the file */
+
+	/* Formatted lines */
+	char *buf;
+	size_t len;
+	size_t cap;
+	int ret;
+};
+
+static int
+get_u64(const char **pp, const char *end, uint64_t *v)
+{
+	const char *p = *pp;
+	uint64_t x = 0;
+
+	for (int shift = 0; shift < 64; shift += 7) {
+		if (p >= end)
+			return -1;
+
+		uint8_t b = (uint8_t) *p++;
+		x |= (uint64_t) (b & 0x7f) << shift;
+		if ((b & 0x80) == 0) {
+			*pp = p;
+			*v = x;
+			return 0;
+		}
+	}
+
+	return -1;
+}
+
+static int
+get_i64(const char **pp, const char *end, int64_t *v)
+{
+	uint64_t zz;
+	if (get_u64(pp, end, &zz) != 0)
+		return -1;
+
+	*v = (int64_t) (zz >> 1) ^ -(int64_t) (zz & 1);
+	return 0;
+}
+
+/* Ensures room for one more formatted line in the block buffer */
+static int
+reserve(struct block *b)
+{
+	if (b->cap - b->len >= PRV_MAXLINE)
+		return 0;
+
+	size_t cap = b->cap * 2;
+	if (cap < PRV_MAXLINE)
+		cap = PRV_MAXLINE;
+
+	char *buf = realloc(b->buf, cap);
+	if (buf == NULL) {
+		err("realloc failed:");
+		return -1;
+	}
+
+	b->buf = buf;
+	b->cap = cap;
+	return 0;
+}
+
+/* Formats the lines of the block as text. Each line but the first of the
+ * file begins with the newline that ends the previous one, as the events
+ * of a line may continue in the next block. */
+static int
+format_block(struct block *b)
+{
+	const char *p = b->data;
+	const char *end = b->data + b->size;
+	int64_t time = b->time;
+	int first = b->first;
+
+	/* The text is usually larger, grown as needed */
+	b->cap = b->size * 2 + PRV_MAXLINE;
+	b->len = 0;
+	b->buf = malloc(b->cap);
+	if (b->buf == NULL) {
+		err("malloc failed:");
+		return -1;
+	}
+
+	while (p < end) {
+		uint64_t row;
+		if (get_u64(&p, end, &row) != 0)
+			goto bad;
+
+		if (reserve(b) != 0)
+			return -1;
+
+		char *q = b->buf + b->len;
+
+		if (row != 0) {
+			uint64_t dt;
+			if (get_u64(&p, end, &dt) != 0)
+				goto bad;
+			time += (int64_t) dt;
+
+			if (!first)
+				*q++ = '\n';
+			first = 0;
+
+			memcpy(q, "2:0:1:1:", 8);
+			q = prv_format_u64(q + 8, row);
+			*q++ = ':';
+			q = prv_format_i64(q, time);
+		} else if (first) {
+			err("event without line in binary PRV block");
+			return -1;
+		}
+
+		int64_t type, value;
+		if (get_i64(&p, end, &type) != 0 || get_i64(&p, end, &value) != 0)
+			goto bad;
+
+		*q++ = ':';
+		q = prv_format_i64(q, type);
+		*q++ = ':';
+		q = prv_format_i64(q, value);
+
+		b->len = (size_t) (q - b->buf);
+	}
+
+	return 0;
+
+bad:
+	err("truncated binary PRV block at offset %zu",
+			(size_t) (p - b->data));
+	return -1;
+}
+
+static void *
+format_run(void *arg)
+{
+	struct block *b = arg;
+	b->ret = format_block(b);
+	return NULL;
+}
+
+/* Reads the block headers from the mapped file */
+static int
+scan_blocks(const char *data, size_t size, struct block **pblocks,
+		long *pnblocks)
+{
+	struct block *blocks = NULL;
+	long nblocks = 0, maxblocks = 0;
+	size_t off = sizeof(struct prv_bin_header);
+
+	while (off < size) {
+		struct prv_bin_block hdr;
+		if (size - off < sizeof(hdr)) {
+			err("truncated binary PRV block header");
+			goto fail;
+		}
+
+		memcpy(&hdr, data + off, sizeof(hdr));
+		off += sizeof(hdr);
+
+		if (hdr.size > size - off) {
+			err("binary PRV block exceeds the file size");
+			goto fail;
+		}
+
+		if (nblocks == maxblocks) {
+			maxblocks = maxblocks ? maxblocks * 2 : 64;
+			struct block *b = realloc(blocks,
+					(size_t) maxblocks * sizeof(struct block));
+			if (b == NULL) {
+				err("realloc failed:");
+				goto fail;
+			}
+			blocks = b;
+		}
+
+		struct block *b = &blocks[nblocks++];
+		memset(b, 0, sizeof(struct block));
+		b->data = data + off;
+		b->size = hdr.size;
+		b->time = hdr.time;
+		b->first = (nblocks == 1);
+
+		off += hdr.size;
+	}
+
+	*pblocks = blocks;
+	*pnblocks = nblocks;
+	return 0;
+
+fail:
+	free(blocks);
+	return -1;
+}
+
+/* Formats the blocks in rounds of nthreads and writes them in order */
+static int
+write_blocks(FILE *f, struct block *blocks, long nblocks, int nthreads)
+{
+	pthread_t *th = calloc((size_t) nthreads, sizeof(pthread_t));
+	if (th == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	int ret = 0;
+	for (long i = 0; i < nblocks && ret == 0; i += nthreads) {
+		long n = nblocks - i;
+		if (n > nthreads)
+			n = nthreads;
+
+		/* The caller formats the first block of the round */
+		long started = 1;
+		for (long j = 1; j < n; j++) {
+			int e = pthread_create(&th[j], NULL, format_run, &blocks[i + j]);
+			if (e != 0) {
+				errno = e;
+				err("pthread_create failed:");
+				ret = -1;
+				break;
+			}
+			started++;
+		}
+
+		format_run(&blocks[i]);
+
+		for (long j = 1; j < started; j++)
+			pthread_join(th[j], NULL);
+
+		for (long j = 0; j < started; j++) {
+			struct block *b = &blocks[i + j];
+			if (b->ret != 0)
+				ret = -1;
+			else if (ret == 0 && b->len > 0
+					&& fwrite(b->buf, b->len, 1, f) != 1) {
+				err("fwrite failed:");
+				ret = -1;
+			}
+			free(b->buf);
+			b->buf = NULL;
+		}
+	}
+
+	free(th);
+	return ret;
+}
+
+/* Converts the binary log in inpath to a PRV file in outpath, formatting
+ * up to nthreads blocks in parallel */
+int
+prv_bin_convert(const char *inpath, const char *outpath, int nthreads)
+{
+	if (nthreads < 1) {
+		err("invalid number of threads %d", nthreads);
+		return -1;
+	}
+
+	int fd = open(inpath, O_RDONLY);
+	if (fd < 0) {
+		err("cannot open binary PRV '%s':", inpath);
+		return -1;
+	}
+
+	struct stat st;
+	if (fstat(fd, &st) != 0) {
+		err("fstat failed for binary PRV '%s':", inpath);
+		close(fd);
+		return -1;
+	}
+
+	size_t size = (size_t) st.st_size;
+	struct prv_bin_header hdr;
+	if (size < sizeof(hdr)) {
+		err("missing header in binary PRV '%s'", inpath);
+		close(fd);
+		return -1;
+	}
+
+	char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED) {
+		err("mmap failed for binary PRV '%s':", inpath);
+		return -1;
+	}
+	posix_madvise(data, size, POSIX_MADV_SEQUENTIAL);
+
+	int ret = -1;
+	struct block *blocks = NULL;
+	long nblocks = 0;
+	FILE *f = NULL;
+
+	memcpy(&hdr, data, sizeof(hdr));
+	if (memcmp(hdr.magic, PRV_BIN_MAGIC, sizeof(hdr.magic)) != 0) {
+		err("bad magic in binary PRV '%s'", inpath);
+		goto out;
+	}
+
+	if (hdr.version != PRV_BIN_VERSION) {
+		err("unsupported binary PRV version %"PRIi64" in '%s', expected %d",
+				hdr.version, inpath, PRV_BIN_VERSION);
+		goto out;
+	}
+
+	if (scan_blocks(data, size, &blocks, &nblocks) != 0) {
+		err("cannot read blocks of binary PRV '%s'", inpath);
+		goto out;
+	}
+
+	f = fopen(outpath, "w");
+	if (f == NULL) {
+		err("cannot open file '%s' for writting:", outpath);
+		goto out;
+	}
+
+	prv_write_header(f, hdr.duration, (long) hdr.nrows);
+
+	if (write_blocks(f, blocks, nblocks, nthreads) != 0) {
+		err("cannot convert binary PRV '%s'", inpath);
+		goto out;
+	}
+
+	/* End the last line */
+	if (nblocks > 0 && fputc('\n', f) == EOF) {
+		err("fputc failed:");
+		goto out;
+	}
+
+	ret = 0;
+
+out:
+	if (f != NULL && fclose(f) != 0) {
+		err("cannot close file '%s':", outpath);
+		ret = -1;
+	}
+	free(blocks);
+	munmap(data, size);
+	return ret;
+}
@@ -0,0 +1,39 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#ifndef PRV_BIN_H
+#define PRV_BIN_H
+
+/* Binary log of the PRV lines, written by prv_open_bin() and converted to
+ * the PRV text format by prv_bin_convert(). The file starts with a struct
+ * prv_bin_header followed by blocks, each made of a struct prv_bin_block
+ * and the encoded lines. The blocks can be formatted independently.
+ *
+ * Each line is encoded as the row (starting at one), the time since the
+ * previous line and the type and value of the first event. The rest of
+ * events of the same line follow as a zero row and the type and value.
+ * The rows and times are unsigned varints (LEB128) and the types and
+ * values zigzag encoded varints, see varint.h. The headers use the host
+ * byte order. */
+
+#include <stdint.h>
+#include "common.h"
+
+#define PRV_BIN_MAGIC "ovniprv"
+#define PRV_BIN_VERSION 1
+
+struct prv_bin_header {
+	char magic[8];
+	int64_t version;
+	int64_t nrows;
+	int64_t duration;
+};
+
+struct prv_bin_block {
+	uint64_t size; /* Bytes of encoded lines after the header */
+	int64_t time;  /* Time of the line before the block */
+};
+
+USE_RET int prv_bin_convert(const char *inpath, const char *outpath, int nthreads);
+
+#endif /* PRV_BIN_H */
@@ -0,0 +1,66 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#ifndef PRV_FORMAT_H
+#define PRV_FORMAT_H
+
+/* Conversion of integers to decimal for the PRV lines, faster than
+ * printf() */
+
+#include <stdint.h>
+
+static const char prv_digits[200] =
+	"0001020304050607080910111213141516171819"
+	"2021222324252627282930313233343536373839"
+	"4041424344454647484950515253545556575859"
+	"6061626364656667686970717273747576777879"
+	"8081828384858687888990919293949596979899";
+
+static const uint64_t prv_pow10[20] = {
+	1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+	10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+	100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+	100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+	100000000000000000ULL, 1000000000000000000ULL,
+	10000000000000000000ULL,
+};
+
+/* Writes the decimal digits of v in p, two at a time from the end, and
+ * returns the position after them */
+static inline char *
+prv_format_u64(char *p, uint64_t v)
+{
+	int n = 1;
+	while (n < 20 && v >= prv_pow10[n])
+		n++;
+
+	char *end = p + n;
+	char *q = end;
+	while (v >= 100) {
+		const char *d = &prv_digits[(v % 100) * 2];
+		v /= 100;
+		*--q = d[1];
+		*--q = d[0];
+	}
+
+	if (v >= 10) {
+		*--q = prv_digits[v * 2 + 1];
+		*--q = prv_digits[v * 2];
+	} else {
+		*--q = (char) ('0' + v);
+	}
+
+	return end;
+}
+
+static inline char *
+prv_format_i64(char *p, int64_t v)
+{
+	if (v >= 0)
+		return prv_format_u64(p, (uint64_t) v);
+
+	*p++ = '-';
+	return prv_format_u64(p, 0 - (uint64_t) v);
+}
+
+#endif /* PRV_FORMAT_H */
@@ -3,13 +3,19 @@
 
 #include "pvt.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
 #include "pv/pcf.h"
 #include "pv/prf.h"
 #include "pv/prv.h"
+#include "columns.h"
+#include "perfetto.h"
+#include "profile.h"
 
 int
-pvt_open(struct pvt *pvt, long nrows, const char *dir, const char *name)
+pvt_open(struct pvt *pvt, long nrows, const char *dir, const char *name,
+		long flags)
 {
 	memset(pvt, 0, sizeof(struct pvt));
 
@@ -23,13 +29,28 @@ pvt_open(struct pvt *pvt, long nrows, const char *dir, const char *name)
 		return -1;
 	}
 
+	/* The binary log is converted to a PRV file by ovni2prv */
 	char prvpath[PATH_MAX];
-	if (snprintf(prvpath, PATH_MAX, "%s/%s.prv", dir, name) >= PATH_MAX) {
+	int binary = (flags & PVT_BINARY) != 0;
+	const char *ext = binary ? "bprv" : "prv";
+	if (snprintf(prvpath, PATH_MAX, "%s/%s.%s", dir, name, ext) >= PATH_MAX) {
 		err("snprintf failed: path too long");
 		return -1;
 	}
-	
-	if (prv_open(&pvt->prv, nrows, prvpath) != 0) {
+
+	/* Without files the channels are only registered in the exporters */
+	int noprv = (flags & PVT_NOPRV) != 0;
+	if (noprv) {
+		if (prv_open_null(&pvt->prv, nrows) != 0) {
+			err("prv_open_null failed");
+			return -1;
+		}
+	} else if (binary) {
+		if (prv_open_bin(&pvt->prv, nrows, prvpath) != 0) {
+			err("prv_open_bin failed");
+			return -1;
+		}
+	} else if (prv_open(&pvt->prv, nrows, prvpath) != 0) {
 		err("prv_open failed");
 		return -1;
 	}
@@ -39,8 +60,8 @@ pvt_open(struct pvt *pvt, long nrows, const char *dir, const char *name)
 		err("snprintf failed: path too long");
 		return -1;
 	}
-	
-	if (pcf_open(&pvt->pcf, pcfpath) != 0) {
+
+	if (pcf_open(&pvt->pcf, noprv ? NULL : pcfpath) != 0) {
 		err("pcf_open failed");
 		return -1;
 	}
@@ -51,11 +72,77 @@ pvt_open(struct pvt *pvt, long nrows, const char *dir, const char *name)
 		return -1;
 	}
 
-	if (prf_open(&pvt->prf, prfpath, nrows) != 0) {
+	if (prf_open(&pvt->prf, noprv ? NULL : prfpath, nrows) != 0) {
 		err("prf_open failed");
 		return -1;
 	}
 
+	if (flags & PVT_PERFETTO) {
+		char pftpath[PATH_MAX];
+		if (snprintf(pftpath, PATH_MAX, "%s/%s.pftrace", dir, name) >= PATH_MAX) {
+			err("snprintf failed: path too long");
+			return -1;
+		}
+
+		pvt->perfetto = calloc(1, sizeof(struct perfetto));
+		if (pvt->perfetto == NULL) {
+			err("calloc failed:");
+			return -1;
+		}
+
+		if (perfetto_open(pvt->perfetto, nrows, pftpath,
+					&pvt->pcf, &pvt->prf) != 0) {
+			err("perfetto_open failed");
+			return -1;
+		}
+
+		/* The channels registered in the PRV are also exported */
+		pvt->prv.perfetto = pvt->perfetto;
+	}
+
+	if (flags & PVT_COLUMNS) {
+		char colpath[PATH_MAX];
+		if (snprintf(colpath, PATH_MAX, "%s/%s.col", dir, name) >= PATH_MAX) {
+			err("snprintf failed: path too long");
+			return -1;
+		}
+
+		pvt->columns = calloc(1, sizeof(struct columns));
+		if (pvt->columns == NULL) {
+			err("calloc failed:");
+			return -1;
+		}
+
+		if (columns_open(pvt->columns, nrows, colpath) != 0) {
+			err("columns_open failed");
+			return -1;
+		}
+
+		pvt->prv.columns = pvt->columns;
+	}
+
+	if (flags & PVT_PROFILE) {
+		char profpath[PATH_MAX];
+		if (snprintf(profpath, PATH_MAX, "%s/%s.prof", dir, name) >= PATH_MAX) {
+			err("snprintf failed: path too long");
+			return -1;
+		}
+
+		pvt->profile = calloc(1, sizeof(struct profile));
+		if (pvt->profile == NULL) {
+			err("calloc failed:");
+			return -1;
+		}
+
+		if (profile_open(pvt->profile, nrows, profpath,
+					&pvt->pcf, &pvt->prf) != 0) {
+			err("profile_open failed");
+			return -1;
+		}
+
+		pvt->prv.profile = pvt->profile;
+	}
+
 	return 0;
 }
 
@@ -80,9 +167,49 @@ pvt_get_prf(struct pvt *pvt)
 int
 pvt_advance(struct pvt *pvt, int64_t time)
 {
+	if (pvt->perfetto != NULL && perfetto_advance(pvt->perfetto, time) != 0)
+		return -1;
+
+	if (pvt->columns != NULL && columns_advance(pvt->columns, time) != 0)
+		return -1;
+
+	if (pvt->profile != NULL && profile_advance(pvt->profile, time) != 0)
+		return -1;
+
 	return prv_advance(&pvt->prv, time);
 }
 
+/* Links the PCF and ROW files of each shard to the shared ones, so Paraver
+ * finds them next to the shard */
+static int
+link_shards(struct pvt *pvt)
+{
+	const char *ext[] = { "pcf", "row" };
+
+	for (long i = 0; i < pvt->prv.nshards; i++) {
+		for (int j = 0; j < 2; j++) {
+			char target[PATH_MAX];
+			char path[PATH_MAX];
+			if (snprintf(target, PATH_MAX, "%s.%s", pvt->name, ext[j]) >= PATH_MAX
+					|| snprintf(path, PATH_MAX, "%s/%s.%ld.%s",
+						pvt->dir, pvt->name, i, ext[j]) >= PATH_MAX) {
+				err("snprintf failed: path too long");
+				return -1;
+			}
+
+			/* From a previous run */
+			unlink(path);
+
+			if (symlink(target, path) != 0) {
+				err("cannot link '%s' to '%s':", path, target);
+				return -1;
+			}
+		}
+	}
+
+	return 0;
+}
+
 int
 pvt_close(struct pvt *pvt)
 {
@@ -101,5 +228,145 @@ pvt_close(struct pvt *pvt)
 		return -1;
 	}
 
+	if (pvt->prv.nshards > 0 && link_shards(pvt) != 0) {
+		err("cannot link the shards of '%s'", pvt->name);
+		return -1;
+	}
+
+	if (pvt->perfetto != NULL && perfetto_close(pvt->perfetto) != 0) {
+		err("perfetto_close failed for '%s'", pvt->name);
+		return -1;
+	}
+
+	if (pvt->columns != NULL && columns_close(pvt->columns) != 0) {
+		err("columns_close failed for '%s'", pvt->name);
+		return -1;
+	}
+
+	if (pvt->profile != NULL && profile_close(pvt->profile) != 0) {
+		err("profile_close failed for '%s'", pvt->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+static int
+part_path(struct pvt *pvt, const char *ext, int part, char *path)
+{
+	if (snprintf(path, PATH_MAX, "%s/%s.%s.part%d",
+				pvt->dir, pvt->name, ext, part) >= PATH_MAX) {
+		err("snprintf failed: path too long");
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Writes the following PRV lines to the file of the given part */
+int
+pvt_split(struct pvt *pvt, int part)
+{
+	char path[PATH_MAX];
+	if (part_path(pvt, "prv", part, path) != 0)
+		return -1;
+
+	if (prv_split(&pvt->prv, path) != 0) {
+		err("prv_split failed for '%s'", pvt->name);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Writes the PRV lines in shards of the given trace time or size,
+ * replacing the PRV file, see prv_shard() */
+int
+pvt_shard(struct pvt *pvt, int64_t ns, int64_t bytes)
+{
+	char base[PATH_MAX];
+	char prvpath[PATH_MAX];
+	if (snprintf(base, PATH_MAX, "%s/%s", pvt->dir, pvt->name) >= PATH_MAX
+			|| snprintf(prvpath, PATH_MAX, "%s.prv", base) >= PATH_MAX) {
+		err("snprintf failed: path too long");
+		return -1;
+	}
+
+	if (prv_shard(&pvt->prv, base, ns, bytes) != 0) {
+		err("prv_shard failed for '%s'", pvt->name);
+		return -1;
+	}
+
+	if (unlink(prvpath) != 0) {
+		err("cannot remove '%s':", prvpath);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Closes the PRV part and saves the PCF values of the part, leaving the
+ * final PCF and ROW files to the main process */
+int
+pvt_close_part(struct pvt *pvt, int part)
+{
+	if (prv_close(&pvt->prv) != 0) {
+		err("prv_close failed for '%s'", pvt->name);
+		return -1;
+	}
+
+	char path[PATH_MAX];
+	if (part_path(pvt, "pcf", part, path) != 0)
+		return -1;
+
+	if (pcf_save(&pvt->pcf, path) != 0) {
+		err("pcf_save failed for '%s'", pvt->name);
+		return -1;
+	}
+
 	return 0;
 }
+
+/* Merges the PRV lines and PCF values of all the parts */
+int
+pvt_merge(struct pvt *pvt, int nparts)
+{
+	char (*paths)[PATH_MAX] = calloc((size_t) nparts, PATH_MAX);
+	char **ptrs = calloc((size_t) nparts, sizeof(char *));
+	if (paths == NULL || ptrs == NULL) {
+		err("calloc failed:");
+		free(paths);
+		free(ptrs);
+		return -1;
+	}
+
+	int ret = -1;
+	for (int i = 0; i < nparts; i++) {
+		if (part_path(pvt, "prv", i, paths[i]) != 0)
+			goto out;
+		ptrs[i] = paths[i];
+	}
+
+	if (prv_merge(&pvt->prv, nparts, ptrs) != 0) {
+		err("prv_merge failed for '%s'", pvt->name);
+		goto out;
+	}
+
+	for (int i = 0; i < nparts; i++) {
+		char path[PATH_MAX];
+		if (part_path(pvt, "pcf", i, path) != 0)
+			goto out;
+
+		if (pcf_merge(&pvt->pcf, path) != 0) {
+			err("pcf_merge failed for '%s'", pvt->name);
+			goto out;
+		}
+	}
+
+	ret = 0;
+
+out:
+	free(paths);
+	free(ptrs);
+	return ret;
+}
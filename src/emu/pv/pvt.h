@@ -12,21 +12,43 @@
 #include "prv.h"
 #include "uthash.h"
 
+struct columns;
+struct perfetto;
+struct profile;
+
+enum pvt_flags {
+	PVT_BINARY   = 1<<0, /* Write the binary log instead of the PRV */
+	PVT_PERFETTO = 1<<1, /* Also export the trace for Perfetto */
+	PVT_COLUMNS  = 1<<2, /* Also export the channels as time series */
+	PVT_PROFILE  = 1<<3, /* Also write the profile of the channels */
+	PVT_NOPRV    = 1<<4, /* Don't write the PRV, PCF and ROW files */
+
+	PVT_EXPORT = PVT_PERFETTO | PVT_COLUMNS | PVT_PROFILE,
+};
+
 struct pvt {
 	char dir[PATH_MAX];
 	char name[PATH_MAX]; /* Without .prv extension */
 	struct prv prv;
 	struct pcf pcf;
 	struct prf prf;
+	struct perfetto *perfetto; /* With PVT_PERFETTO */
+	struct columns *columns; /* With PVT_COLUMNS */
+	struct profile *profile; /* With PVT_PROFILE */
 
 	struct UT_hash_handle hh; /* For recorder */
 };
 
-USE_RET int pvt_open(struct pvt *pvt, long nrows, const char *dir, const char *name);
+USE_RET int pvt_open(struct pvt *pvt, long nrows, const char *dir, const char *name,
+		long flags);
 USE_RET struct prv *pvt_get_prv(struct pvt *pvt);
 USE_RET struct pcf *pvt_get_pcf(struct pvt *pvt);
 USE_RET struct prf *pvt_get_prf(struct pvt *pvt);
 USE_RET int pvt_advance(struct pvt *pvt, int64_t time);
 USE_RET int pvt_close(struct pvt *pvt);
+USE_RET int pvt_split(struct pvt *pvt, int part);
+USE_RET int pvt_shard(struct pvt *pvt, int64_t ns, int64_t bytes);
+USE_RET int pvt_close_part(struct pvt *pvt, int part);
+USE_RET int pvt_merge(struct pvt *pvt, int nparts);
 
 #endif /* PVT_H */
@@ -10,15 +10,20 @@
 #include "uthash.h"
 
 int
-recorder_init(struct recorder *rec, const char *dir)
+recorder_init(struct recorder *rec, const char *dir, long flags)
 {
 	memset(rec, 0, sizeof(struct recorder));
 
+	rec->flags = flags;
 	if (snprintf(rec->dir, PATH_MAX, "%s", dir) >= PATH_MAX) {
 		err("snprintf failed: path too long");
 		return -1;
 	}
 
+	/* The configurations are only for the PRV */
+	if (flags & PVT_NOPRV)
+		return 0;
+
 	/* TODO: Use configs per pvt */
 	if (cfg_generate(rec->dir) != 0) {
 		err("cfg_generate failed");
@@ -52,11 +57,22 @@ recorder_add_pvt(struct recorder *rec, const char *name, long nrows)
 		return NULL;
 	}
 
-	if (pvt_open(pvt, nrows, rec->dir, name) != 0) {
+	if (pvt_open(pvt, nrows, rec->dir, name, rec->flags) != 0) {
 		err("pvt_open failed");
 		return NULL;
 	}
 
+	if (rec->coalesce && prv_coalesce(&pvt->prv) != 0) {
+		err("prv_coalesce failed");
+		return NULL;
+	}
+
+	if ((rec->shard_ns > 0 || rec->shard_bytes > 0)
+			&& pvt_shard(pvt, rec->shard_ns, rec->shard_bytes) != 0) {
+		err("pvt_shard failed");
+		return NULL;
+	}
+
 	HASH_ADD_STR(rec->pvt, name, pvt);
 
 	return pvt;
@@ -65,6 +81,10 @@ recorder_add_pvt(struct recorder *rec, const char *name, long nrows)
 int
 recorder_advance(struct recorder *rec, int64_t time)
 {
+	/* Nothing is written at the given time */
+	if ((rec->flags & PVT_NOPRV) && (rec->flags & PVT_EXPORT) == 0)
+		return 0;
+
 	for (struct pvt *pvt = rec->pvt; pvt; pvt = pvt->hh.next) {
 		if (pvt_advance(pvt, time) != 0) {
 			err("pvt_advance failed");
@@ -75,6 +95,24 @@ recorder_advance(struct recorder *rec, int64_t time)
 	return 0;
 }
 
+/* Writes the PRV lines of the events emitted since the last commit, when
+ * they are grouped by row and time */
+int
+recorder_commit(struct recorder *rec)
+{
+	if (!rec->coalesce)
+		return 0;
+
+	for (struct pvt *pvt = rec->pvt; pvt; pvt = pvt->hh.next) {
+		if (prv_commit(&pvt->prv) != 0) {
+			err("prv_commit failed");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
 int
 recorder_finish(struct recorder *rec)
 {
@@ -89,3 +127,64 @@ recorder_finish(struct recorder *rec)
 
 	return 0;
 }
+
+long
+recorder_ntraces(struct recorder *rec)
+{
+	return (long) HASH_COUNT(rec->pvt);
+}
+
+/* Sends the PRV lines of each trace to its own queue instead of writing
+ * them, in the order of the traces, or writes them again if queues is
+ * NULL */
+void
+recorder_set_queues(struct recorder *rec, struct spsc *const queues[])
+{
+	long i = 0;
+	for (struct pvt *pvt = rec->pvt; pvt; pvt = pvt->hh.next)
+		pvt->prv.queue = queues ? queues[i++] : NULL;
+}
+
+/* Redirects the output of the emulation worker to its own part files */
+int
+recorder_split(struct recorder *rec, int part)
+{
+	for (struct pvt *pvt = rec->pvt; pvt; pvt = pvt->hh.next) {
+		if (pvt_split(pvt, part) != 0) {
+			err("pvt_split failed");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+int
+recorder_finish_part(struct recorder *rec, int part)
+{
+	for (struct pvt *pvt = rec->pvt; pvt; pvt = pvt->hh.next) {
+		if (pvt_close_part(pvt, part) != 0) {
+			err("pvt_close_part failed");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* Collects the parts written by all the workers, so the traces can be
+ * finished with recorder_finish() */
+int
+recorder_merge(struct recorder *rec, int nparts)
+{
+	info("merging %d parts, please wait", nparts);
+
+	for (struct pvt *pvt = rec->pvt; pvt; pvt = pvt->hh.next) {
+		if (pvt_merge(pvt, nparts) != 0) {
+			err("pvt_merge failed");
+			return -1;
+		}
+	}
+
+	return 0;
+}
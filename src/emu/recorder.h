@@ -9,16 +9,27 @@
 #include <limits.h>
 #include <stdint.h>
 #include "common.h"
+struct spsc;
 
 struct recorder {
 	char dir[PATH_MAX]; /* To place the traces */
 	struct pvt *pvt; /* Hash table by name */
+	int coalesce; /* Group the PRV events of each row and time */
+	long flags; /* Of the traces, as in pvt_open() */
+	int64_t shard_ns; /* Split the PRV in shards, as in pvt_shard() */
+	int64_t shard_bytes;
 };
 
-USE_RET int recorder_init(struct recorder *rec, const char *dir);
+USE_RET int recorder_init(struct recorder *rec, const char *dir, long flags);
 USE_RET struct pvt *recorder_find_pvt(struct recorder *rec, const char *name);
 USE_RET struct pvt *recorder_add_pvt(struct recorder *rec, const char *name, long nrows);
 USE_RET int recorder_advance(struct recorder *rec, int64_t time);
+USE_RET int recorder_commit(struct recorder *rec);
 USE_RET int recorder_finish(struct recorder *rec);
+        long recorder_ntraces(struct recorder *rec);
+        void recorder_set_queues(struct recorder *rec, struct spsc *const queues[]);
+USE_RET int recorder_split(struct recorder *rec, int part);
+USE_RET int recorder_finish_part(struct recorder *rec, int part);
+USE_RET int recorder_merge(struct recorder *rec, int nparts);
 
 #endif /* RECORDER_H */
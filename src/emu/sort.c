@@ -22,6 +22,82 @@ cmp_int64(const void *a, const void *b)
 		return 0;
 }
 
+/* Returns the index of the first element in arr[lo..hi) greater than v, or hi
+ * if there is none */
+static int64_t
+upper_bound(const int64_t *arr, int64_t lo, int64_t hi, int64_t v)
+{
+	while (lo < hi) {
+		int64_t m = lo + (hi - lo) / 2;
+		if (arr[m] <= v)
+			lo = m + 1;
+		else
+			hi = m;
+	}
+
+	return lo;
+}
+
+/* Returns the index of the first element in arr[lo..hi) not less than v, or
+ * hi if there is none */
+static int64_t
+lower_bound(const int64_t *arr, int64_t lo, int64_t hi, int64_t v)
+{
+	while (lo < hi) {
+		int64_t m = lo + (hi - lo) / 2;
+		if (arr[m] < v)
+			lo = m + 1;
+		else
+			hi = m;
+	}
+
+	return lo;
+}
+
+static void
+set_rank(int64_t *arr, int64_t i, int64_t v, struct sort *sort)
+{
+	if (arr[i] == v)
+		return;
+
+	arr[i] = v;
+
+	if (sort != NULL && !sort->dirty[i]) {
+		sort->dirty[i] = 1;
+		sort->changed[sort->nchanged++] = i;
+	}
+}
+
+/* Replaces old by new in the sorted array. Each run of equal values between
+ * old and new only moves its first or last element, found by binary search,
+ * so the cost depends on the number of distinct values crossed and not on
+ * the array size. The written ranks are recorded in the sort, if given. */
+static void
+replace(int64_t *arr, int64_t n, int64_t old, int64_t new, struct sort *sort)
+{
+	if (old < new) {
+		/* Move the first element of each run to the left */
+		int64_t i = upper_bound(arr, 0, n, old) - 1;
+		while (i + 1 < n && arr[i + 1] <= new) {
+			int64_t v = arr[i + 1];
+			int64_t last = upper_bound(arr, i + 1, n, v) - 1;
+			set_rank(arr, i, v, sort);
+			i = last;
+		}
+		set_rank(arr, i, new, sort);
+	} else {
+		/* Move the last element of each run to the right */
+		int64_t i = lower_bound(arr, 0, n, old);
+		while (i > 0 && arr[i - 1] > new) {
+			int64_t v = arr[i - 1];
+			int64_t first = lower_bound(arr, 0, i - 1, v);
+			set_rank(arr, i, v, sort);
+			i = first;
+		}
+		set_rank(arr, i, new, sort);
+	}
+}
+
 /** Replaces the value old in the array arr by new, while keeping the
  * array arr sorted.
  *
@@ -36,42 +112,7 @@ sort_replace(int64_t *arr, int64_t n, int64_t old, int64_t new)
 	if (unlikely(old == new))
 		die("old == new");
 
-	/* Remove the old first then insert the new */
-	if (old < new) {
-		int64_t i = 0;
-
-		/* Quick jump to middle if less than old */
-		int64_t m = n / 2;
-		if (arr[m] < old)
-			i = m;
-
-		/* Skip content until old, no need to copy */
-		for (; arr[i] < old; i++)
-			;
-
-		/* Copy middle section replacing old */
-		for (; i < n - 1 && arr[i + 1] <= new; i++)
-			arr[i] = arr[i + 1];
-
-		/* Place new */
-		arr[i] = new;
-	} else { /* new < old */
-		int64_t i = 0;
-
-		/* Find old, must be found */
-		for (; arr[i] < old; i++)
-			;
-
-		/* Shift right to replace old */
-		for (; i > 0 && arr[i - 1] > new; i--)
-			arr[i] = arr[i - 1];
-
-		/* Invariant: Either i == 0 or arr[i] <= new
-		 * and the element arr[i] must be gone */
-
-		/* Place new */
-		arr[i] = new;
-	}
+	replace(arr, n, old, new, NULL);
 }
 
 /** Called when an input channel changes its value */
@@ -104,14 +145,42 @@ sort_cb_input(struct chan *in_chan, void *ptr)
 	sort->values[index] = new;
 
 	if (likely(sort->copied)) {
-		sort_replace(sort->sorted, sort->n, old, new);
+		replace(sort->sorted, sort->n, old, new, sort);
 	} else {
 		memcpy(sort->sorted, sort->values, (size_t) sort->n * sizeof(int64_t));
 		qsort(sort->sorted, (size_t) sort->n, sizeof(int64_t), cmp_int64);
 		sort->copied = 1;
+
+		/* The outputs have not been written yet */
+		for (int64_t i = 0; i < sort->n; i++) {
+			sort->dirty[i] = 1;
+			sort->changed[i] = i;
+		}
+		sort->nchanged = sort->n;
 	}
 
-	for (int64_t i = 0; i < sort->n; i++) {
+	/* Write the outputs once all inputs are updated */
+	return bay_defer(sort->bay, &sort->task);
+}
+
+/** Writes the outputs of the ranks that have changed */
+static int
+sort_eval(void *arg)
+{
+	struct sort *sort = arg;
+
+	/* Write the outputs in rank order, as the lines in the trace
+	 * follow the order in which the channels are written */
+	if (sort->nchanged > 1)
+		qsort(sort->changed, (size_t) sort->nchanged,
+				sizeof(int64_t), cmp_int64);
+
+	for (int64_t k = 0; k < sort->nchanged; k++) {
+		int64_t i = sort->changed[k];
+		sort->dirty[i] = 0;
+
+		/* May be back to the last value if more than one input
+		 * changed in this propagation */
 		struct value val = value_int64(sort->sorted[i]);
 		struct value last;
 		if (chan_read(&sort->outputs[i], &last) != 0) {
@@ -132,6 +201,8 @@ sort_cb_input(struct chan *in_chan, void *ptr)
 		}
 	}
 
+	sort->nchanged = 0;
+
 	return 0;
 }
 
@@ -161,6 +232,21 @@ sort_init(struct sort *sort, struct bay *bay, int64_t n, const char *name)
 		err("calloc failed:");
 		return -1;
 	}
+	sort->changed = calloc((size_t) n, sizeof(int64_t));
+	if (sort->changed == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+	sort->dirty = calloc((size_t) n, sizeof(char));
+	if (sort->dirty == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	if (bay_add_task(bay, &sort->task, sort_eval, sort) != 0) {
+		err("bay_add_task failed");
+		return -1;
+	}
 
 	/* Init and register outputs */
 	for (int64_t i = 0; i < n; i++) {
@@ -179,6 +265,11 @@ sort_init(struct sort *sort, struct bay *bay, int64_t n, const char *name)
 			err("bay_register out%"PRIi64" failed", i);
 			return -1;
 		}
+
+		if (bay_task_output(bay, &sort->task, out) != 0) {
+			err("bay_task_output failed");
+			return -1;
+		}
 	}
 
 	return 0;
@@ -203,6 +294,11 @@ sort_set_input(struct sort *sort, int64_t index, struct chan *chan)
 		return -1;
 	}
 
+	if (bay_task_input(sort->bay, &sort->task, chan) != 0) {
+		err("bay_task_input failed");
+		return -1;
+	}
+
 	return 0;
 }
 
@@ -5,6 +5,7 @@
 #define SORT_H
 
 #include <stdint.h>
+#include "bay.h"
 #include "common.h"
 struct bay;
 struct chan;
@@ -21,8 +22,12 @@ struct sort {
 	struct chan *outputs;
 	int64_t *values;
 	int64_t *sorted;
+	int64_t *changed; /* Ranks written since the last evaluation */
+	int64_t nchanged;
+	char *dirty;      /* Whether each rank is in changed */
 	int copied;
 	struct bay *bay;
+	struct bay_task task;
 };
 
 USE_RET int sort_init(struct sort *sort, struct bay *bay, int64_t n, const char *name);
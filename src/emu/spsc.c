@@ -0,0 +1,39 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "spsc.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Initializes the queue with room for n elements, which must be a power
+ * of two */
+int
+spsc_init(struct spsc *q, size_t elemsize, size_t n)
+{
+	memset(q, 0, sizeof(struct spsc));
+
+	if (n == 0 || (n & (n - 1)) != 0) {
+		err("queue size %zu is not a power of two", n);
+		return -1;
+	}
+
+	q->buf = calloc(n, elemsize);
+	if (q->buf == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	q->mask = n - 1;
+	q->elemsize = elemsize;
+	atomic_init(&q->head, 0);
+	atomic_init(&q->tail, 0);
+
+	return 0;
+}
+
+void
+spsc_free(struct spsc *q)
+{
+	free(q->buf);
+	q->buf = NULL;
+}
@@ -0,0 +1,82 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#ifndef SPSC_H
+#define SPSC_H
+
+/* Bounded lock-free queue of fixed size elements with a single producer
+ * and a single consumer thread. The elements are written and read in
+ * place: the producer claims the next free slot, fills it and pushes it;
+ * the consumer takes the front slot and pops it once done. */
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include "common.h"
+
+#define SPSC_CACHELINE 64
+
+struct spsc {
+	/* Only written by the consumer */
+	_Alignas(SPSC_CACHELINE) atomic_size_t head;
+	size_t tail_cache;
+
+	/* Only written by the producer */
+	_Alignas(SPSC_CACHELINE) atomic_size_t tail;
+	size_t head_cache;
+
+	/* Read-only after init */
+	_Alignas(SPSC_CACHELINE) size_t mask;
+	size_t elemsize;
+	char *buf;
+};
+
+USE_RET int spsc_init(struct spsc *q, size_t elemsize, size_t n);
+        void spsc_free(struct spsc *q);
+
+/* Returns the next free slot or NULL if the queue is full */
+static inline void *
+spsc_claim(struct spsc *q)
+{
+	size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+
+	if (tail - q->head_cache > q->mask) {
+		q->head_cache = atomic_load_explicit(&q->head, memory_order_acquire);
+		if (tail - q->head_cache > q->mask)
+			return NULL;
+	}
+
+	return q->buf + (tail & q->mask) * q->elemsize;
+}
+
+/* Makes the slot returned by spsc_claim() visible to the consumer */
+static inline void
+spsc_push(struct spsc *q)
+{
+	size_t tail = atomic_load_explicit(&q->tail, memory_order_relaxed);
+	atomic_store_explicit(&q->tail, tail + 1, memory_order_release);
+}
+
+/* Returns the oldest slot or NULL if the queue is empty */
+static inline void *
+spsc_front(struct spsc *q)
+{
+	size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+
+	if (head == q->tail_cache) {
+		q->tail_cache = atomic_load_explicit(&q->tail, memory_order_acquire);
+		if (head == q->tail_cache)
+			return NULL;
+	}
+
+	return q->buf + (head & q->mask) * q->elemsize;
+}
+
+/* Releases the slot returned by spsc_front() back to the producer */
+static inline void
+spsc_pop(struct spsc *q)
+{
+	size_t head = atomic_load_explicit(&q->head, memory_order_relaxed);
+	atomic_store_explicit(&q->head, head + 1, memory_order_release);
+}
+
+#endif /* SPSC_H */
@@ -0,0 +1,38 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#ifndef STATE_TABLE_H
+#define STATE_TABLE_H
+
+/* Tables of the simple events of a model, which push, pop or set a state
+ * in a channel given the category and value of the event. Only the
+ * categories with events have a row of 256 small entries, declared with
+ * STATE_ROW, so each table takes a few KiB. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+enum { PUSH = 1, POP = 2, SET = 3, IGN = 4 };
+
+struct state_entry {
+	int8_t chan;
+	int8_t action; /* Zero if the event is not in the table */
+	int16_t st;
+};
+
+#define STATE_ROW (const struct state_entry[256])
+
+static const struct state_entry state_entry_none;
+
+/* Returns the entry of the event, with zero action if there is none */
+static inline const struct state_entry *
+state_table_get(const struct state_entry *const table[256], uint8_t c, uint8_t v)
+{
+	const struct state_entry *row = table[c];
+	if (row == NULL)
+		return &state_entry_none;
+
+	return &row[v];
+}
+
+#endif /* STATE_TABLE_H */
@@ -1,16 +1,146 @@
-/* Copyright (c) 2021-2024 Barcelona Supercomputing Center (BSC)
+/* Copyright (c) 2021-2025 Barcelona Supercomputing Center (BSC)
  * SPDX-License-Identifier: GPL-3.0-or-later */
 
+#define _DEFAULT_SOURCE /* For madvise() */
+
+/* Must be included before common.h poisons usleep() */
+#include <unistd.h>
+
 #include "stream.h"
 #include <fcntl.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/mman.h>
 #include <sys/stat.h>
-#include <unistd.h>
 #include "ovni.h"
 #include "path.h"
 
+/* Streams are read sequentially, so we ask the kernel to page in the next
+ * window of the stream ahead of the current offset and release the
+ * previous one once we are done with it. It must be a power of two and a
+ * multiple of the page size. */
+#define STREAM_WINDOW (4LL * 1024LL * 1024LL)
+
+static void
+advise(struct stream *stream, int64_t start, int64_t end, int advice)
+{
+	/* Not mapped */
+	if (stream->window != 0)
+		return;
+
+	if (start < 0)
+		start = 0;
+	if (end > stream->size)
+		end = stream->size;
+	if (start >= end)
+		return;
+
+	/* Only a hint, so errors are not fatal */
+	if (madvise(stream->buf + start, (size_t) (end - start), advice) != 0)
+		dbg("madvise failed for stream %s:", stream->relpath);
+}
+
+/* Called when the offset enters a new window */
+static void
+advance_window(struct stream *stream)
+{
+	int64_t w = stream->offset / STREAM_WINDOW;
+
+	/* Read the next window ahead */
+	advise(stream, (w + 1) * STREAM_WINDOW, (w + 2) * STREAM_WINDOW,
+			MADV_WILLNEED);
+
+	/* Keep the previous window, as the current event may begin there */
+	advise(stream, (w - 2) * STREAM_WINDOW, (w - 1) * STREAM_WINDOW,
+			MADV_DONTNEED);
+}
+
+/* Loads the stream bytes up to the end offset into the window buffer,
+ * keeping the ones from the current offset, and then reads ahead as much
+ * as fits in the window. The file is reopened on every fill, so we don't
+ * keep one descriptor per stream. */
+static int
+fill(struct stream *stream, int64_t end)
+{
+	int64_t keep = stream->bufend - stream->offset;
+	int64_t need = end - stream->offset;
+
+	/* Move the remaining bytes to the front */
+	if (keep > 0)
+		memmove(stream->buf, stream->buf + (stream->offset - stream->bufoff),
+				(size_t) keep);
+
+	/* Grow the buffer for events larger than the window, and shrink it
+	 * back once they are consumed */
+	int64_t bufsize = stream->window;
+	if (need > bufsize)
+		bufsize = need;
+
+	if (bufsize != stream->bufsize) {
+		uint8_t *buf = realloc(stream->buf, (size_t) bufsize);
+		if (buf == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		stream->buf = buf;
+		stream->bufsize = bufsize;
+	}
+
+	stream->bufoff = stream->offset;
+	stream->bufend = stream->offset + keep;
+
+	int64_t left = stream->size - stream->bufend;
+	int64_t room = stream->bufsize - keep;
+	int64_t want = left < room ? left : room;
+
+	int fd = open(stream->obspath, O_RDONLY);
+	if (fd == -1) {
+		err("open %s failed:", stream->obspath);
+		return -1;
+	}
+
+	while (want > 0) {
+		ssize_t n = pread(fd, stream->buf + (stream->bufend - stream->bufoff),
+				(size_t) want, (off_t) stream->bufend);
+		if (n < 0) {
+			err("pread %s failed:", stream->obspath);
+			close(fd);
+			return -1;
+		} else if (n == 0) {
+			break;
+		}
+		stream->bufend += n;
+		want -= n;
+	}
+
+	if (close(fd) != 0) {
+		err("close failed:");
+		return -1;
+	}
+
+	if (stream->bufend < end) {
+		err("stream '%s' truncated at %"PRIi64" while reading",
+				stream->relpath, stream->bufend);
+		return -1;
+	}
+
+	return 0;
+}
+
+/* Ensures the stream bytes up to end (or the stream size) are loaded */
+static inline int
+ensure(struct stream *stream, int64_t end)
+{
+	if (end > stream->size)
+		end = stream->size;
+
+	if (likely(end <= stream->bufend))
+		return 0;
+
+	return fill(stream, end);
+}
+
 static int
 check_stream_header(struct stream *stream)
 {
@@ -58,7 +188,8 @@ load_stream_fd(struct stream *stream, int fd)
 		return -1;
 	}
 
-	int prot = PROT_READ | PROT_WRITE;
+	/* The stream is never modified through the mapping */
+	int prot = PROT_READ;
 	stream->buf = mmap(NULL, (size_t) st.st_size, prot, MAP_PRIVATE, fd, 0);
 
 	if (stream->buf == MAP_FAILED) {
@@ -67,22 +198,56 @@ load_stream_fd(struct stream *stream, int fd)
 	}
 
 	stream->size = st.st_size;
+	stream->bufend = stream->size;
+
+	/* Increase the kernel readahead, but don't populate the whole
+	 * stream, only the first windows */
+	advise(stream, 0, stream->size, MADV_SEQUENTIAL);
+	advise(stream, 0, 2 * STREAM_WINDOW, MADV_WILLNEED);
 
 	return 0;
 }
 
+static int
+load_stream_window(struct stream *stream, int fd)
+{
+	struct stat st;
+	if (fstat(fd, &st) < 0) {
+		err("fstat failed:");
+		return -1;
+	}
+
+	/* Error because it doesn't have the header */
+	if (st.st_size == 0) {
+		err("stream %s is empty", stream->path);
+		return -1;
+	}
+
+	stream->size = st.st_size;
+
+	/* Read the first window, which includes the header */
+	return ensure(stream, (int64_t) sizeof(struct ovni_stream_header));
+}
+
 static int
 load_obs(struct stream *stream, const char *path)
 {
 	int fd;
-	if ((fd = open(path, O_RDWR)) == -1) {
+	if ((fd = open(path, O_RDONLY)) == -1) {
 		err("open %s failed:", path);
 		return -1;
 	}
 
-	if (load_stream_fd(stream, fd) != 0) {
-		err("load_stream_fd failed for: %s", path);
-		return -1;
+	if (stream->window == 0) {
+		if (load_stream_fd(stream, fd) != 0) {
+			err("load_stream_fd failed for: %s", path);
+			return -1;
+		}
+	} else {
+		if (load_stream_window(stream, fd) != 0) {
+			err("load_stream_window failed for: %s", path);
+			return -1;
+		}
 	}
 
 	if (check_stream_header(stream) != 0) {
@@ -156,32 +321,41 @@ load_json(const char *path)
 	return meta;
 }
 
-/** Loads a stream from disk.
- *
- * The relpath must be pointing to a directory with the stream.json and
- * stream.obs files.
- */
-int
-stream_load(struct stream *stream, const char *tracedir, const char *relpath)
+static int
+load(struct stream *stream, const char *tracedir, const char *relpath,
+		int64_t window)
 {
 	memset(stream, 0, sizeof(struct stream));
+	stream->window = window;
+
+	struct stream_paths *paths = calloc(1, sizeof(struct stream_paths));
+	if (paths == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	stream->paths = paths;
+	stream->path = paths->path;
+	stream->relpath = paths->relpath;
+	stream->obspath = paths->obspath;
+	stream->jsonpath = paths->jsonpath;
 
-	if (snprintf(stream->path, PATH_MAX, "%s/%s", tracedir, relpath) >= PATH_MAX) {
+	if (snprintf(paths->path, PATH_MAX, "%s/%s", tracedir, relpath) >= PATH_MAX) {
 		err("path too long: %s/%s", tracedir, relpath);
 		return -1;
 	}
 
 	/* Allow loading a trace with empty relpath */
-	path_remove_trailing(stream->path);
+	path_remove_trailing(paths->path);
 
-	if (snprintf(stream->relpath, PATH_MAX, "%s", relpath) >= PATH_MAX) {
+	if (snprintf(paths->relpath, PATH_MAX, "%s", relpath) >= PATH_MAX) {
 		err("path too long: %s", relpath);
 		return -1;
 	}
 
 	dbg("loading %s", stream->relpath);
 
-	if (path_append(stream->jsonpath, stream->path, "stream.json") != 0) {
+	if (path_append(paths->jsonpath, stream->path, "stream.json") != 0) {
 		err("path_append failed");
 		return -1;
 	}
@@ -191,7 +365,7 @@ stream_load(struct stream *stream, const char *tracedir, const char *relpath)
 		return -1;
 	}
 
-	if (path_append(stream->obspath, stream->path, "stream.obs") != 0) {
+	if (path_append(paths->obspath, stream->path, "stream.obs") != 0) {
 		err("path_append failed");
 		return -1;
 	}
@@ -204,6 +378,34 @@ stream_load(struct stream *stream, const char *tracedir, const char *relpath)
 	return 0;
 }
 
+/** Loads a stream from disk.
+ *
+ * The relpath must be pointing to a directory with the stream.json and
+ * stream.obs files.
+ */
+int
+stream_load(struct stream *stream, const char *tracedir, const char *relpath)
+{
+	return load(stream, tracedir, relpath, 0);
+}
+
+/** Loads a stream from disk, but instead of mapping the whole stream, the
+ * events are read as they are needed through a buffer of the given window
+ * size, so the memory used doesn't depend on the stream size.
+ */
+int
+stream_load_window(struct stream *stream, const char *tracedir,
+		const char *relpath, int64_t window)
+{
+	if (window < STREAM_MIN_WINDOW) {
+		err("window too small: %"PRIi64" (min %lld)",
+				window, STREAM_MIN_WINDOW);
+		return -1;
+	}
+
+	return load(stream, tracedir, relpath, window);
+}
+
 void
 stream_data_set(struct stream *stream, void *data)
 {
@@ -274,8 +476,13 @@ stream_step(struct stream *stream)
 
 	/* Only step the offset if we have loaded an event */
 	if (stream->cur_ev != NULL) {
+		int64_t last = stream->offset;
 		stream->offset += ovni_ev_size(stream->cur_ev);
 
+		/* Crossed a window boundary */
+		if (unlikely((last ^ stream->offset) >= STREAM_WINDOW))
+			advance_window(stream);
+
 		/* It cannot pass the size, otherwise we are reading garbage */
 		if (stream->offset > stream->size) {
 			err("stream offset %"PRIi64" exceeds size %"PRIi64,
@@ -291,15 +498,36 @@ stream_step(struct stream *stream)
 		}
 	}
 
-	stream->cur_ev = (struct ovni_ev *) &stream->buf[stream->offset];
+	/* Enough to read the size of any event, even jumbo ones */
+	int64_t head = (int64_t) (sizeof(struct ovni_ev_header) + sizeof(uint32_t));
+	if (ensure(stream, stream->offset + head) != 0) {
+		err("cannot read event header from stream '%s'", stream->relpath);
+		return -1;
+	}
+
+	stream->cur_ev = (struct ovni_ev *) &stream->buf[stream->offset - stream->bufoff];
+	int64_t next = stream->offset + ovni_ev_size(stream->cur_ev);
 
 	/* Ensure the event fits */
-	if (stream->offset + ovni_ev_size(stream->cur_ev) > stream->size) {
+	if (next > stream->size) {
 		err("stream '%s' ends with incomplete event",
 				stream->relpath);
 		return -1;
 	}
 
+	/* The buffer may be moved to read the rest of the event */
+	if (unlikely(next > stream->bufend)) {
+		if (ensure(stream, next) != 0) {
+			err("cannot read event from stream '%s'", stream->relpath);
+			return -1;
+		}
+		stream->cur_ev = (struct ovni_ev *) &stream->buf[stream->offset - stream->bufoff];
+	}
+
+	/* Bring the header of the next event, as it is going to be read
+	 * when we step this stream again */
+	__builtin_prefetch(&stream->buf[next - stream->bufoff]);
+
 	int64_t clock = stream_evclock(stream, stream->cur_ev);
 
 	/* Ensure the clock grows monotonically if unsorted flag not set */
@@ -314,7 +542,6 @@ stream_step(struct stream *stream)
 		}
 	}
 
-	stream->deltaclock = clock - stream->lastclock;
 	stream->lastclock = clock;
 
 	return 0;
@@ -1,4 +1,4 @@
-/* Copyright (c) 2021-2024 Barcelona Supercomputing Center (BSC)
+/* Copyright (c) 2021-2025 Barcelona Supercomputing Center (BSC)
  * SPDX-License-Identifier: GPL-3.0-or-later */
 
 #ifndef STREAM_H
@@ -7,41 +7,53 @@
 #include <limits.h>
 #include <stdint.h>
 #include "common.h"
-#include "heap.h"
 #include "parson.h"
 struct ovni_ev;
 
+/* Smallest window allowed when reading streams with stream_load_window() */
+#define STREAM_MIN_WINDOW (64LL * 1024LL)
+
+/* Paths of the stream, only needed when loading it or reporting errors */
+struct stream_paths {
+	char path[PATH_MAX]; /* To stream dir */
+	char relpath[PATH_MAX]; /* To tracedir */
+	char obspath[PATH_MAX]; /* To obs file */
+	char jsonpath[PATH_MAX]; /* To json file */
+};
+
+/* The fields used on every event are placed first, so they fit in a single
+ * cache line. The rest are only needed when loading the stream or when
+ * reporting errors. */
 struct stream {
 	struct ovni_ev *cur_ev;
 	uint8_t *buf;
+	int64_t bufoff; /* Stream offset of buf[0] */
+	int64_t bufend; /* Stream offset past the last loaded byte */
 	int64_t size;
+	int64_t offset;
 	int64_t lastclock;
-	int64_t deltaclock;
 	int64_t clock_offset;
-
-	heap_node_t hh;
-	struct stream *next;
-	struct stream *prev;
-
-	void *data; /* To hold system details */
-
 	int active;
 	int unsorted;
 
-	char path[PATH_MAX]; /* To stream dir */
-	char relpath[PATH_MAX]; /* To tracedir */
-	char obspath[PATH_MAX]; /* To obs file */
-	char jsonpath[PATH_MAX]; /* To json file */
+	/* Only when reading through a window, otherwise zero */
+	int64_t window; /* Requested size of the window */
+	int64_t bufsize; /* Allocated size of buf */
 
 	int64_t usize; /* Useful size for events */
-	int64_t offset;
-
-	double progress;
-
+	void *data; /* To hold system details */
 	JSON_Object *meta;
+
+	/* Point to the paths table */
+	const char *path;
+	const char *relpath;
+	const char *obspath;
+	const char *jsonpath;
+	struct stream_paths *paths;
 };
 
 USE_RET int stream_load(struct stream *stream, const char *tracedir, const char *relpath);
+USE_RET int stream_load_window(struct stream *stream, const char *tracedir, const char *relpath, int64_t window);
 USE_RET int stream_clkoff_set(struct stream *stream, int64_t clock_offset);
         void stream_progress(struct stream *stream, int64_t *done, int64_t *total);
 USE_RET int stream_step(struct stream *stream);
@@ -238,7 +238,8 @@ create_system(struct system *sys, struct trace *trace)
 	}
 
 	size_t i = 0;
-	for (struct stream *s = trace->streams; s ; s = s->next) {
+	for (long j = 0; j < trace->nstreams; j++) {
+		struct stream *s = &trace->streams[j];
 		int ok = is_thread_stream(s);
 		if (ok < 0) {
 			err("is_thread_stream failed");
@@ -530,7 +531,8 @@ init_offsets(struct system *sys, struct trace *trace)
 		}
 	}
 
-	for (struct stream *s = trace->streams; s; s = s->next) {
+	for (long i = 0; i < trace->nstreams; i++) {
+		struct stream *s = &trace->streams[i];
 		struct lpt *lpt = system_get_lpt(s);
 		/* Not LPT stream */
 		if (lpt == NULL)
@@ -654,6 +656,116 @@ system_get_lpt(struct stream *stream)
 	return lpt;
 }
 
+struct loom_weight {
+	struct loom *loom;
+	int64_t bytes;
+};
+
+static int
+cmp_weight(const void *a, const void *b)
+{
+	const struct loom_weight *wa = a;
+	const struct loom_weight *wb = b;
+
+	/* Heaviest first, then by loom order */
+	if (wa->bytes != wb->bytes)
+		return wa->bytes < wb->bytes ? 1 : -1;
+
+	if (wa->loom->gindex != wb->loom->gindex)
+		return wa->loom->gindex < wb->loom->gindex ? -1 : 1;
+
+	return 0;
+}
+
+/* Assigns each loom to one of the nparts emulation workers, placing the
+ * looms with more events first in the least loaded worker. Returns the
+ * number of workers used, which is never more than the number of looms,
+ * or -1 on error. */
+int
+system_partition(struct system *sys, struct trace *trace, int nparts)
+{
+	if (nparts < 1) {
+		err("invalid number of parts %d", nparts);
+		return -1;
+	}
+
+	size_t n = sys->nlooms;
+	if ((size_t) nparts > n)
+		nparts = (int) n;
+
+	struct loom_weight *w = calloc(n, sizeof(struct loom_weight));
+	int64_t *load = calloc((size_t) nparts, sizeof(int64_t));
+	if (w == NULL || load == NULL) {
+		err("calloc failed:");
+		free(w);
+		free(load);
+		return -1;
+	}
+
+	for (struct loom *l = sys->looms; l; l = l->next)
+		w[l->gindex].loom = l;
+
+	for (long i = 0; i < trace->nstreams; i++) {
+		struct stream *s = &trace->streams[i];
+		struct lpt *lpt = system_get_lpt(s);
+		if (lpt != NULL)
+			w[lpt->loom->gindex].bytes += s->usize;
+	}
+
+	qsort(w, n, sizeof(struct loom_weight), cmp_weight);
+
+	for (size_t i = 0; i < n; i++) {
+		int best = 0;
+		for (int k = 1; k < nparts; k++) {
+			if (load[k] < load[best])
+				best = k;
+		}
+
+		w[i].loom->part = best;
+		load[best] += w[i].bytes;
+	}
+
+	for (int k = 0; k < nparts; k++)
+		dbg("part %d has %"PRIi64" bytes of streams", k, load[k]);
+
+	free(w);
+	free(load);
+
+	return nparts;
+}
+
+/* Removes from the global lists the looms not assigned to the given part
+ * and their processes, threads and CPUs, so the models only see the part
+ * of the system emulated by the current worker. The global indices and
+ * counters are kept, as they define the rows of the output traces. */
+void
+system_select(struct system *sys, int part)
+{
+	struct loom *l, *ltmp;
+	DL_FOREACH_SAFE(sys->looms, l, ltmp) {
+		if (l->part != part)
+			DL_DELETE(sys->looms, l);
+	}
+
+	struct proc *p, *ptmp;
+	DL_FOREACH_SAFE2(sys->procs, p, ptmp, gnext) {
+		if (p->loom->part != part)
+			DL_DELETE2(sys->procs, p, gprev, gnext);
+	}
+
+	struct thread *t, *ttmp;
+	DL_FOREACH_SAFE2(sys->threads, t, ttmp, gnext) {
+		if (t->proc->loom->part != part)
+			DL_DELETE2(sys->threads, t, gprev, gnext);
+	}
+
+	struct cpu *c, *ctmp;
+	DL_FOREACH_SAFE(sys->cpus, c, ctmp) {
+		if (c->loom->part != part)
+			DL_DELETE(sys->cpus, c);
+	}
+}
+
 static void 
 system_get_accelerators(struct system *sys)
 {
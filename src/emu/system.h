@@ -59,5 +59,7 @@ struct system {
 USE_RET int system_init(struct system *sys, struct emu_args *args, struct trace *trace);
 USE_RET int system_connect(struct system *sys, struct bay *bay, struct recorder *rec);
 USE_RET struct lpt *system_get_lpt(struct stream *stream);
+USE_RET int system_partition(struct system *sys, struct trace *trace, int nparts);
+        void system_select(struct system *sys, int part);
 
 #endif /* EMU_SYSTEM_H */
@@ -8,35 +8,34 @@
 #include "emu_ev.h"
 #include "extend.h"
 #include "model_thread.h"
+#include "state_table.h"
 #include "thread.h"
 #include "value.h"
 
-enum { PUSH = 1, POP = 2, IGN = 3 };
-
 #define CHSS CH_SUBSYSTEM
 
-static const int ss_table[256][256][3] = {
-	['C'] = {
+static const struct state_entry *const ss_table[256] = {
+	['C'] = STATE_ROW {
 		['i'] = { CHSS, PUSH, ST_COMM_ISSUE_NONBLOCKING },
 		['I'] = { CHSS, POP,  ST_COMM_ISSUE_NONBLOCKING },
 	},
-	['G'] = {
+	['G'] = STATE_ROW {
 		['c'] = { CHSS, PUSH, ST_GLOBAL_ARRAY_CHECK },
 		['C'] = { CHSS, POP,  ST_GLOBAL_ARRAY_CHECK },
 	},
-	['L'] = {
+	['L'] = STATE_ROW {
 		['i'] = { CHSS, PUSH, ST_LIBRARY_INTERFACE },
 		['I'] = { CHSS, POP,  ST_LIBRARY_INTERFACE },
 		['p'] = { CHSS, PUSH, ST_LIBRARY_POLLING },
 		['P'] = { CHSS, POP,  ST_LIBRARY_POLLING },
 	},
-	['Q'] = {
+	['Q'] = STATE_ROW {
 		['a'] = { CHSS, PUSH, ST_QUEUE_ADD },
 		['A'] = { CHSS, POP,  ST_QUEUE_ADD },
 		['t'] = { CHSS, PUSH, ST_QUEUE_TRANSFER },
 		['T'] = { CHSS, POP,  ST_QUEUE_TRANSFER },
 	},
-	['R'] = {
+	['R'] = STATE_ROW {
 		['c'] = { CHSS, PUSH, ST_REQUEST_COMPLETED },
 		['C'] = { CHSS, POP,  ST_REQUEST_COMPLETED },
 		['t'] = { CHSS, PUSH, ST_REQUEST_TEST },
@@ -46,7 +45,7 @@ static const int ss_table[256][256][3] = {
 		['s'] = { CHSS, PUSH, ST_REQUEST_TESTSOME },
 		['S'] = { CHSS, POP,  ST_REQUEST_TESTSOME },
 	},
-	['T'] = {
+	['T'] = STATE_ROW {
 		['c'] = { CHSS, PUSH, ST_TICKET_CREATE },
 		['C'] = { CHSS, POP,  ST_TICKET_CREATE },
 		['w'] = { CHSS, PUSH, ST_TICKET_WAIT },
@@ -54,18 +53,25 @@ static const int ss_table[256][256][3] = {
 	},
 };
 
-static int
-process_ev(struct emu *emu)
+int
+model_tampi_check(struct emu *emu)
 {
 	if (!emu->thread->is_running) {
 		err("current thread %d not running", emu->thread->tid);
 		return -1;
 	}
 
-	const int *entry = ss_table[emu->ev->c][emu->ev->v];
-	int chind = entry[0];
-	int action = entry[1];
-	int st = entry[2];
+	return 0;
+}
+
+static int
+simple(struct emu *emu)
+{
+	const struct state_entry *entry = state_table_get(ss_table,
+			emu->ev->c, emu->ev->v);
+	int chind = entry->chan;
+	int action = entry->action;
+	int st = entry->st;
 
 	struct tampi_thread *th = EXT(emu->thread, 'T');
 	struct chan *ch = &th->m.ch[chind];
@@ -82,20 +88,12 @@ process_ev(struct emu *emu)
 	return -1;
 }
 
-int
-model_tampi_event(struct emu *emu)
-{
-	dbg("in tampi_event");
-	if (emu->ev->m != 'T') {
-		err("unexpected event model %c", emu->ev->m);
-		return -1;
-	}
-
-	dbg("got tampi event %s", emu->ev->mcv);
-	if (process_ev(emu) != 0) {
-		err("error processing TAMPI event");
-		return -1;
-	}
-
-	return 0;
-}
+struct model_handler model_tampi_handlers[] = {
+	{ "TC", simple },
+	{ "TG", simple },
+	{ "TL", simple },
+	{ "TQ", simple },
+	{ "TR", simple },
+	{ "TT", simple },
+	{ NULL, NULL },
+};
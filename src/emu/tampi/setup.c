@@ -48,7 +48,8 @@ struct model_spec model_tampi = {
 	.model   = model_id,
 	.create  = model_tampi_create,
 	.connect = model_tampi_connect,
-	.event   = model_tampi_event,
+	.check   = model_tampi_check,
+	.handlers = model_tampi_handlers,
 	.probe   = model_tampi_probe,
 	.finish  = model_tampi_finish,
 };
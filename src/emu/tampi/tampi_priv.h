@@ -5,6 +5,7 @@
 #define TAMPI_PRIV_H
 
 #include "emu.h"
+#include "model.h"
 #include "model_cpu.h"
 #include "model_thread.h"
 
@@ -41,7 +42,9 @@ struct tampi_cpu {
 int model_tampi_probe(struct emu *emu);
 int model_tampi_create(struct emu *emu);
 int model_tampi_connect(struct emu *emu);
-int model_tampi_event(struct emu *emu);
+int model_tampi_check(struct emu *emu);
 int model_tampi_finish(struct emu *emu);
 
+extern struct model_handler model_tampi_handlers[];
+
 #endif /* TAMPI_PRIV_H */
@@ -1,4 +1,4 @@
-/* Copyright (c) 2021-2024 Barcelona Supercomputing Center (BSC)
+/* Copyright (c) 2021-2025 Barcelona Supercomputing Center (BSC)
  * SPDX-License-Identifier: GPL-3.0-or-later */
 
 #define _XOPEN_SOURCE 500
@@ -13,29 +13,20 @@
 #include "ovni.h"
 #include "path.h"
 #include "stream.h"
-#include "utlist.h"
 
 /* See the nftw(3) manual to see why we need a global variable here:
  * https://pubs.opengroup.org/onlinepubs/9699919799/functions/nftw.html */
 static struct trace *cur_trace = NULL;
 
-static void
-add_stream(struct trace *trace, struct stream *stream)
-{
-	DL_APPEND(trace->streams, stream);
-	trace->nstreams++;
-}
+/* Relative paths of the streams found while walking the trace directory,
+ * which are only loaded once we know how many there are, so they can be
+ * placed in a contiguous array. */
+static char **relpaths = NULL;
+static long maxrelpaths = 0;
 
 static int
-load_stream(struct trace *trace, const char *json_path)
+add_relpath(struct trace *trace, const char *json_path)
 {
-	struct stream *stream = calloc(1, sizeof(struct stream));
-
-	if (stream == NULL) {
-		err("calloc failed:");
-		return -1;
-	}
-
 	/* The json_path must end in .../stream.json, so remove it */
 	char path[PATH_MAX];
 	if (path_copy(path, json_path) != 0) {
@@ -50,12 +41,24 @@ load_stream(struct trace *trace, const char *json_path)
 	/* Skip begin slashes */
 	while (relpath[0] == '/') relpath++;
 
-	if (stream_load(stream, trace->tracedir, relpath) != 0) {
-		err("emu_steam_load failed");
+	if (trace->nstreams >= maxrelpaths) {
+		long n = maxrelpaths == 0 ? 64 : 2 * maxrelpaths;
+		char **p = realloc(relpaths, (size_t) n * sizeof(char *));
+		if (p == NULL) {
+			err("realloc failed:");
+			return -1;
+		}
+		relpaths = p;
+		maxrelpaths = n;
+	}
+
+	char *dup = strdup(relpath);
+	if (dup == NULL) {
+		err("strdup failed:");
 		return -1;
 	}
 
-	add_stream(trace, stream);
+	relpaths[trace->nstreams++] = dup;
 
 	return 0;
 }
@@ -84,17 +87,70 @@ cb_nftw(const char *fpath, const struct stat *sb,
 	if (!is_stream(fpath))
 		return 0;
 
-	return load_stream(cur_trace, fpath);
+	return add_relpath(cur_trace, fpath);
 }
 
 static int
-cmp_streams(struct stream *a, struct stream *b)
+cmp_relpaths(const void *a, const void *b)
 {
-	return strcmp(a->relpath, b->relpath);
+	return strcmp(*(char * const *) a, *(char * const *) b);
 }
 
-int
-trace_load(struct trace *trace, const char *tracedir)
+static int
+load_streams(struct trace *trace, int64_t budget)
+{
+	/* Sort the streams */
+	qsort(relpaths, (size_t) trace->nstreams, sizeof(char *), cmp_relpaths);
+
+	trace->streams = calloc((size_t) trace->nstreams, sizeof(struct stream));
+	if (trace->nstreams > 0 && trace->streams == NULL) {
+		err("calloc failed:");
+		return -1;
+	}
+
+	/* Share the budget among all streams */
+	int64_t window = 0;
+	if (budget > 0 && trace->nstreams > 0) {
+		window = budget / trace->nstreams;
+		if (window < STREAM_MIN_WINDOW) {
+			warn("budget too small for %ld streams, using %lld KiB per stream",
+					trace->nstreams, STREAM_MIN_WINDOW / 1024LL);
+			window = STREAM_MIN_WINDOW;
+		}
+		info("reading streams through a %"PRIi64" KiB window",
+				window / 1024);
+	}
+
+	for (long i = 0; i < trace->nstreams; i++) {
+		struct stream *stream = &trace->streams[i];
+		int ret;
+		if (window == 0)
+			ret = stream_load(stream, trace->tracedir, relpaths[i]);
+		else
+			ret = stream_load_window(stream, trace->tracedir, relpaths[i], window);
+
+		if (ret != 0) {
+			err("emu_steam_load failed");
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static void
+free_relpaths(struct trace *trace)
+{
+	for (long i = 0; i < trace->nstreams; i++)
+		free(relpaths[i]);
+
+	free(relpaths);
+	relpaths = NULL;
+	maxrelpaths = 0;
+}
+
+static int
+load(struct trace *trace, const char *tracedir, int64_t budget)
 {
 	memset(trace, 0, sizeof(struct trace));
 
@@ -129,10 +185,35 @@ trace_load(struct trace *trace, const char *tracedir)
 
 	cur_trace = NULL;
 
-	/* Sort the streams */
-	DL_SORT(trace->streams, cmp_streams);
+	if (load_streams(trace, budget) != 0) {
+		err("load_streams failed");
+		return -1;
+	}
+
+	free_relpaths(trace);
 
 	info("loaded %ld streams", trace->nstreams);
 
 	return 0;
 }
+
+/** Loads the trace mapping all the streams in memory. */
+int
+trace_load(struct trace *trace, const char *tracedir)
+{
+	return load(trace, tracedir, 0);
+}
+
+/** Loads the trace reading the streams through windows, so the memory used
+ * for the events is bounded by the budget (in bytes) shared among all the
+ * streams, regardless of the trace size. */
+int
+trace_load_bounded(struct trace *trace, const char *tracedir, int64_t budget)
+{
+	if (budget <= 0) {
+		err("invalid budget %"PRIi64, budget);
+		return -1;
+	}
+
+	return load(trace, tracedir, budget);
+}
@@ -1,19 +1,22 @@
-/* Copyright (c) 2021-2023 Barcelona Supercomputing Center (BSC)
+/* Copyright (c) 2021-2025 Barcelona Supercomputing Center (BSC)
  * SPDX-License-Identifier: GPL-3.0-or-later */
 
 #ifndef EMU_TRACE_H
 #define EMU_TRACE_H
 
 #include <limits.h>
+#include <stdint.h>
 #include "common.h"
 
 struct trace {
 	char tracedir[PATH_MAX];
 
+	/* Contiguous array sorted by the relative path */
 	long nstreams;
 	struct stream *streams;
 };
 
 USE_RET int trace_load(struct trace *trace, const char *tracedir);
+USE_RET int trace_load_bounded(struct trace *trace, const char *tracedir, int64_t budget);
 
 #endif /* EMU_TRACE_H */
@@ -0,0 +1,37 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#ifndef VARINT_H
+#define VARINT_H
+
+/* Variable length integers as in LEB128 and protobuf: seven bits per byte
+ * starting from the lowest ones, with the high bit set in all the bytes
+ * but the last. The signed integers are zigzag encoded first, so the
+ * small negative values also take few bytes. */
+
+#include <stdint.h>
+
+/* Longest varint of 64 bits */
+#define VARINT_MAX 10
+
+/* Writes the varint at p and returns the position past it */
+static inline char *
+varint_put_u64(char *p, uint64_t v)
+{
+	while (v >= 0x80) {
+		*p++ = (char) (v | 0x80);
+		v >>= 7;
+	}
+	*p++ = (char) v;
+
+	return p;
+}
+
+static inline char *
+varint_put_i64(char *p, int64_t v)
+{
+	uint64_t zz = ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+	return varint_put_u64(p, zz);
+}
+
+#endif /* VARINT_H */
@@ -25,11 +25,6 @@ event_s(struct emu *emu)
 		return -1;
 	}
 
-	if (emu->ev->v != 'e') {
-		err("unknown event value");
-		return -1;
-	}
-
 	uint64_t value = emu->ev->payload->u64[0];
 	uint32_t id = emu->ev->payload->u32[2];
 	uint32_t type = emu->ev->payload->u32[3];
@@ -53,23 +48,9 @@ event_s(struct emu *emu)
 	return 0;
 }
 
-static int
-process_ev(struct emu *emu)
-{
-	switch (emu->ev->c) {
-		case 's':
-			return event_s(emu);
-		default:
-			err("unknown xtasks event category");
-			return -1;
-	}
-
-	/* Not reached */
-	return 0;
-}
-
+/* Connects the channels on the first event */
 int
-model_xtasks_event(struct emu *emu)
+model_xtasks_check(struct emu *emu)
 {
 	static int enabled = 0;
 
@@ -81,17 +62,10 @@ model_xtasks_event(struct emu *emu)
 		enabled = 1;
 	}
 
-	dbg("in xtasks_event");
-	if (emu->ev->m != 'X') {
-		err("unexpected event model %c", emu->ev->m);
-		return -1;
-	}
-
-	dbg("got xtasks event %s", emu->ev->mcv);
-	if (process_ev(emu) != 0) {
-		err("error processing Kernel event");
-		return -1;
-	}
-
 	return 0;
 }
+
+struct model_handler model_xtasks_handlers[] = {
+	{ "Xse", event_s },
+	{ NULL, NULL },
+};
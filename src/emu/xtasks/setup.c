@@ -32,7 +32,8 @@ struct model_spec model_xtasks = {
 	.model = model_id,
 	.create  = model_xtasks_create,
 //	.connect = model_xtasks_connect,
-	.event   = model_xtasks_event,
+	.check   = model_xtasks_check,
+	.handlers = model_xtasks_handlers,
 	.probe   = model_xtasks_probe,
 	.finish  = model_xtasks_finish,
 };
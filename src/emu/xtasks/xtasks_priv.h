@@ -5,6 +5,7 @@
 #define XTASKS_PRIV_H
 
 #include "emu.h"
+#include "model.h"
 #include "model_cpu.h"
 #include "model_thread.h"
 
@@ -22,7 +23,9 @@ struct xtasks_thread {
 int model_xtasks_probe(struct emu *emu);
 int model_xtasks_create(struct emu *emu);
 int model_xtasks_connect(struct emu *emu);
-int model_xtasks_event(struct emu *emu);
+int model_xtasks_check(struct emu *emu);
 int model_xtasks_finish(struct emu *emu);
 
+extern struct model_handler model_xtasks_handlers[];
+
 #endif /* XTASKS_PRIV_H */
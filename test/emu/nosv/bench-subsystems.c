@@ -0,0 +1,54 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "compat.h"
+#include "instr.h"
+#include "instr_nosv.h"
+
+/* Microbenchmark of the nOS-V subsystem events, which are decoded with the
+ * state table of the model. Emits many API enter and exit events of
+ * several categories, so the speed in kev/s reported by ovniemu at the
+ * end mostly depends on the handling of these events. */
+
+#define NITER 500000
+
+typedef void (*instr_fn)(void);
+
+static const instr_fn enter[] = {
+	instr_nosv_submit_enter,
+	instr_nosv_mutex_lock_enter,
+	instr_nosv_mutex_unlock_enter,
+	instr_nosv_barrier_wait_enter,
+	instr_nosv_cond_signal_enter,
+};
+
+static const instr_fn leave[] = {
+	instr_nosv_submit_exit,
+	instr_nosv_mutex_lock_exit,
+	instr_nosv_mutex_unlock_exit,
+	instr_nosv_barrier_wait_exit,
+	instr_nosv_cond_signal_exit,
+};
+
+int
+main(void)
+{
+	instr_start(0, 1);
+	instr_nosv_init();
+
+	int n = (int) (sizeof(enter) / sizeof(enter[0]));
+	for (int i = 0; i < NITER; i++) {
+		int a = i % n;
+		int b = (i / n) % n;
+
+		/* Nest two calls to push more than one state */
+		enter[a]();
+		enter[b]();
+		leave[b]();
+		leave[a]();
+	}
+
+	instr_end();
+
+	return 0;
+}
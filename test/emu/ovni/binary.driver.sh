@@ -0,0 +1,32 @@
+target=$OVNI_TEST_BIN
+
+# Run one loom per rank
+for rank in 0 1 2 3; do
+  OVNI_RANK=$rank OVNI_NRANKS=4 $target &
+done
+wait
+
+for dir in text textg bin bing; do
+  cp -r ovni $dir
+done
+
+ovniemu -l text
+ovniemu -l -g textg
+ovniemu -l -z bin
+ovniemu -l -g -p -z bing
+
+# Only the binary logs are written
+test ! -e bin/thread.prv
+ovni2prv bin/thread.bprv bin/cpu.bprv
+ovni2prv -j 3 bing/thread.bprv bing/cpu.bprv
+
+# Same lines as written by the emulator
+for f in thread cpu; do
+  cmp text/$f.prv bin/$f.prv
+  cmp textg/$f.prv bing/$f.prv
+done
+
+# The parts of the parallel workers are merged as text
+if ovniemu -z -j 2 ovni; then
+  exit 1
+fi
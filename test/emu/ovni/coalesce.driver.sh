@@ -0,0 +1,29 @@
+target=$OVNI_TEST_BIN
+
+# Run one loom per rank
+for rank in 0 1 2 3; do
+  OVNI_RANK=$rank OVNI_NRANKS=4 $target &
+done
+wait
+
+cp -r ovni single
+cp -r ovni pipe
+ovniemu -l single
+ovniemu -l -g ovni
+ovniemu -l -g -p pipe
+
+# Writes each event of the grouped lines in its own line
+expand() {
+  awk -F: '/^2:/ { for (i = 7; i < NF; i += 2) print $1 ":" $2 ":" $3 ":" $4 ":" $5 ":" $6 ":" $i ":" $(i+1); next } { print }' "$1"
+}
+
+for f in thread cpu; do
+  # The pipeline groups the lines in the same way
+  cmp ovni/$f.prv pipe/$f.prv
+
+  # Same events, in fewer lines
+  expand ovni/$f.prv | sort > a.prv
+  sort single/$f.prv > b.prv
+  cmp a.prv b.prv
+  test $(wc -l < ovni/$f.prv) -lt $(wc -l < single/$f.prv)
+done
@@ -0,0 +1,22 @@
+target=$OVNI_TEST_BIN
+
+# Run one loom per rank
+for rank in 0 1 2 3; do
+  OVNI_RANK=$rank OVNI_NRANKS=4 $target &
+done
+wait
+
+cp -r ovni text
+ovniemu -l text
+ovniemu -l -t -p ovni
+
+# Exported along the same PRV files
+for f in thread cpu; do
+  test "$(head -c 7 ovni/$f.col)" = "ovnicol"
+  cmp text/$f.prv ovni/$f.prv
+done
+
+# Only the PRV parts are merged
+if ovniemu -t -j 2 text; then
+  exit 1
+fi
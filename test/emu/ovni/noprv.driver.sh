@@ -0,0 +1,24 @@
+target=$OVNI_TEST_BIN
+
+# Run one loom per rank
+for rank in 0 1 2 3; do
+  OVNI_RANK=$rank OVNI_NRANKS=4 $target &
+done
+wait
+
+cp -r ovni prv
+ovniemu -l -r prv
+ovniemu -l -r -n ovni
+
+# Only the profile is written, with the same values
+for f in thread cpu; do
+  test ! -e ovni/$f.prv
+  test ! -e ovni/$f.pcf
+  test ! -e ovni/$f.row
+  cmp prv/$f.prof ovni/$f.prof
+done
+test ! -e ovni/cfg
+
+if ovniemu -n -j 2 ovni; then
+  exit 1
+fi
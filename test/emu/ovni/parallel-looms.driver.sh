@@ -0,0 +1,38 @@
+target=$OVNI_TEST_BIN
+
+# Run one loom per rank
+for rank in 0 1 2 3; do
+  OVNI_RANK=$rank OVNI_NRANKS=4 $target &
+done
+wait
+
+# Emulate the looms in one process, pipelined and in parallel
+cp -r ovni serial
+cp -r ovni pipe
+ovniemu -l serial
+ovniemu -l -p pipe
+ovniemu -l -j 3 ovni
+
+# No parts must be left behind
+if ls ovni/*.part* 2>/dev/null; then
+  echo "found part files"
+  exit 1
+fi
+
+for f in thread cpu; do
+  # The pipeline writes exactly the same files
+  cmp serial/$f.prv pipe/$f.prv
+  cmp serial/$f.pcf pipe/$f.pcf
+
+  # Same header, rows and labels
+  cmp serial/$f.row ovni/$f.row
+  sort serial/$f.pcf > a.pcf
+  sort ovni/$f.pcf > b.pcf
+  cmp a.pcf b.pcf
+
+  # Same lines, sorted by time
+  sort serial/$f.prv > a.prv
+  sort ovni/$f.prv > b.prv
+  cmp a.prv b.prv
+  sed 1d ovni/$f.prv | sort -s -t: -k6,6n -c
+done
@@ -0,0 +1,19 @@
+target=$OVNI_TEST_BIN
+
+# Run one loom per rank
+for rank in 0 1 2 3; do
+  OVNI_RANK=$rank OVNI_NRANKS=4 $target &
+done
+wait
+
+ovniemu -l -r ovni
+
+# Some time was accounted in each trace
+for f in thread cpu; do
+  head -1 ovni/$f.prof | grep -q "^# row"
+  awk -F '\t' 'NR > 1 && $4 > 0 && $5 > 0 { n++ } END { exit n == 0 }' ovni/$f.prof
+done
+
+if ovniemu -r -j 2 ovni; then
+  exit 1
+fi
@@ -0,0 +1,34 @@
+target=$OVNI_TEST_BIN
+
+# Run one loom per rank
+for rank in 0 1 2 3; do
+  OVNI_RANK=$rank OVNI_NRANKS=4 $target &
+done
+wait
+
+cp -r ovni full
+ovniemu -l full
+ovniemu -l -s 1K ovni
+
+for f in thread cpu; do
+  test ! -e ovni/$f.prv
+  test -e ovni/$f.1.prv
+
+  # All the lines are in the shards, which begin with the current values
+  grep -hv '^#' ovni/$f.*.prv | sort -u > shards.txt
+  grep -v '^#' full/$f.prv | sort -u > full.txt
+  test -z "$(comm -23 full.txt shards.txt)"
+
+  # Every shard can be opened alone
+  for prv in ovni/$f.*.prv; do
+    test "$(readlink ${prv%.prv}.pcf)" = "$f.pcf"
+    test "$(readlink ${prv%.prv}.row)" = "$f.row"
+    end=$(head -1 $prv | sed 's/.*:0*\([0-9]*\)_ns.*/\1/')
+    last=$(tail -1 $prv | cut -d: -f6)
+    test "$last" -le "$end"
+  done
+done
+
+if ovniemu -s 1K -p ovni; then
+  exit 1
+fi
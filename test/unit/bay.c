@@ -3,6 +3,8 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include "common.h"
 #include "emu/bay.h"
 #include "emu/chan.h"
@@ -61,6 +63,214 @@ test_callback(struct bay *bay)
 		die("data didn't change after bay_propagate");
 }
 
+/* Registering many channels must keep them reachable by name and keep
+ * the callbacks of the first ones working */
+static void
+test_many(struct bay *bay)
+{
+	long n = 10000;
+	struct chan *chans = calloc((size_t) n, sizeof(struct chan));
+	if (chans == NULL)
+		die("calloc failed:");
+
+	int64_t data = 0;
+	for (long i = 0; i < n; i++) {
+		chan_init(&chans[i], CHAN_SINGLE, "many.%ld", i);
+		OK(bay_register(bay, &chans[i]));
+
+		if (i == 0 && bay_add_cb(bay, BAY_CB_DIRTY, &chans[i], callback, &data, 1) == NULL)
+			die("bay_add_cb failed");
+	}
+
+	for (long i = 0; i < n; i += 97) {
+		char name[MAX_CHAN_NAME];
+		sprintf(name, "many.%ld", i);
+		if (bay_find(bay, name) != &chans[i])
+			die("bay_find returned wrong channel for %s", name);
+	}
+
+	if (bay_find(bay, "many.missing") != NULL)
+		die("bay_find found a missing channel");
+
+	OK(chan_set(&chans[n - 1], value_int64(2)));
+	OK(chan_set(&chans[0], value_int64(3)));
+	OK(bay_propagate(bay));
+
+	if (data != 3)
+		die("data didn't change after bay_propagate");
+}
+
+struct adder {
+	struct bay *bay;
+	struct bay_task task;
+	struct chan *in[2];
+	struct chan *out;
+	int nruns;
+};
+
+static int
+adder_eval(void *arg)
+{
+	struct adder *adder = arg;
+	struct value a, b;
+	OK(chan_read(adder->in[0], &a));
+	OK(chan_read(adder->in[1], &b));
+
+	int64_t sum = 0;
+	if (a.type == VALUE_INT64)
+		sum += a.i;
+	if (b.type == VALUE_INT64)
+		sum += b.i;
+
+	adder->nruns++;
+
+	return chan_set(adder->out, value_int64(sum));
+}
+
+static int
+adder_cb(struct chan *chan, void *ptr)
+{
+	UNUSED(chan);
+	struct adder *adder = ptr;
+	return bay_defer(adder->bay, &adder->task);
+}
+
+static void
+adder_init(struct adder *adder, struct bay *bay, struct chan *a,
+		struct chan *b, struct chan *out)
+{
+	adder->bay = bay;
+	adder->in[0] = a;
+	adder->in[1] = b;
+	adder->out = out;
+	OK(bay_add_task(bay, &adder->task, adder_eval, adder));
+	for (int i = 0; i < 2; i++) {
+		OK(bay_task_input(bay, &adder->task, adder->in[i]));
+		if (bay_add_cb(bay, BAY_CB_DIRTY, adder->in[i], adder_cb, adder, 1) == NULL)
+			die("bay_add_cb failed");
+	}
+	OK(bay_task_output(bay, &adder->task, out));
+}
+
+/* Test that a task only runs once all its inputs are updated, even if
+ * they are in different levels */
+static void
+test_levels(void)
+{
+	struct bay bay;
+	bay_init(&bay);
+
+	/* b = x + y, c = x + b */
+	struct chan x, y, b, c;
+	chan_init(&x, CHAN_SINGLE, "x");
+	chan_init(&y, CHAN_SINGLE, "y");
+	chan_init(&b, CHAN_SINGLE, "b");
+	chan_init(&c, CHAN_SINGLE, "c");
+	OK(bay_register(&bay, &x));
+	OK(bay_register(&bay, &y));
+	OK(bay_register(&bay, &c)); /* Before b on purpose */
+	OK(bay_register(&bay, &b));
+
+	struct adder add_b = {0}, add_c = {0};
+	adder_init(&add_c, &bay, &x, &b, &c);
+	adder_init(&add_b, &bay, &x, &y, &b);
+
+	OK(bay_compile(&bay));
+
+	OK(chan_set(&x, value_int64(1)));
+	OK(chan_set(&y, value_int64(2)));
+	OK(bay_propagate(&bay));
+
+	struct value v;
+	OK(chan_read(&c, &v));
+	if (v.i != 4)
+		die("unexpected value %"PRIi64" in c", v.i);
+
+	if (add_b.nruns != 1 || add_c.nruns != 1)
+		die("tasks run more than once: %d %d", add_b.nruns, add_c.nruns);
+
+	err("OK");
+}
+
+/* Test that cycles are detected */
+static void
+test_cycle(void)
+{
+	struct bay bay;
+	bay_init(&bay);
+
+	struct chan x, y;
+	chan_init(&x, CHAN_SINGLE, "x");
+	chan_init(&y, CHAN_SINGLE, "y");
+	OK(bay_register(&bay, &x));
+	OK(bay_register(&bay, &y));
+
+	/* y = x + y */
+	struct adder add = {0};
+	adder_init(&add, &bay, &x, &y, &y);
+
+	ERR(bay_compile(&bay));
+
+	err("OK");
+}
+
+static int
+count(struct chan *chan, void *ptr)
+{
+	UNUSED(chan);
+	int *n = ptr;
+	(*n)++;
+	return 0;
+}
+
+static void
+test_filter(void)
+{
+	struct bay bay;
+	bay_init(&bay);
+
+	struct chan a, b, c;
+	chan_init(&a, CHAN_SINGLE, "same");
+	chan_init(&b, CHAN_SINGLE, "null");
+	chan_init(&c, CHAN_SINGLE, "none");
+	struct chan *chans[] = { &a, &b, &c };
+	int n[3] = { 0 };
+	for (int i = 0; i < 3; i++) {
+		chan_prop_set(chans[i], CHAN_ALLOW_DUP, 1);
+		OK(bay_register(&bay, chans[i]));
+		if (bay_add_cb(&bay, BAY_CB_EMIT, chans[i], count, &n[i], 1) == NULL)
+			die("bay_add_cb failed");
+	}
+
+	OK(bay_filter(&bay, &a, BAY_FILTER_SAME));
+	OK(bay_filter(&bay, &b, BAY_FILTER_SAME));
+	/* Keeps the one that drops less */
+	OK(bay_filter(&bay, &b, BAY_FILTER_NULL));
+	OK(bay_filter(&bay, &b, BAY_FILTER_SAME));
+
+	struct value values[] = {
+		value_int64(1), value_int64(1), value_null(),
+		value_null(), value_int64(1), value_int64(1),
+	};
+
+	for (int i = 0; i < 6; i++) {
+		for (int j = 0; j < 3; j++)
+			OK(chan_set(chans[j], values[i]));
+		OK(bay_propagate(&bay));
+	}
+
+	if (n[0] != 3 || n[1] != 5 || n[2] != 6)
+		die("bad number of emits: %d %d %d", n[0], n[1], n[2]);
+
+	struct bay_chan *ba = &bay.channels[a.id];
+	if (ba->nfiltered != 3 || ba->nemitted != 3)
+		die("bad filter stats");
+
+	bay_report(&bay);
+
+	err("OK");
+}
+
 int main(void)
 {
 	struct bay bay;
@@ -68,6 +278,10 @@ int main(void)
 
 	test_duplicate(&bay);
 	test_callback(&bay);
+	test_many(&bay);
+	test_levels();
+	test_cycle();
+	test_filter();
 
 	return 0;
 }
@@ -117,12 +117,46 @@ test_ignore_dup(void)
 	err("OK");
 }
 
+/* Test that the stack grows as needed up to the limit and keeps the values,
+ * and that channels with the same name share it */
+static void
+test_stack(void)
+{
+	struct chan chan;
+	chan_init(&chan, CHAN_STACK, "testchan");
+	chan_prop_set(&chan, CHAN_DIRTY_WRITE, 1);
+
+	for (int i = 0; i < MAX_CHAN_STACK; i++)
+		OK(chan_push(&chan, value_int64(i + 1)));
+
+	/* Full */
+	ERR(chan_push(&chan, value_int64(MAX_CHAN_STACK + 1)));
+
+	for (int i = MAX_CHAN_STACK; i > 0; i--)
+		OK(chan_pop(&chan, value_int64(i)));
+
+	ERR(chan_pop(&chan, value_int64(1)));
+
+	struct chan other;
+	chan_init(&other, CHAN_SINGLE, "testchan");
+	if (other.name != chan.name)
+		die("channel name not interned");
+
+	struct chan_stats stats;
+	chan_stats_get(&stats);
+	if (stats.stack_bytes != MAX_CHAN_STACK * (int64_t) sizeof(struct value))
+		die("unexpected stack memory %"PRIi64, stats.stack_bytes);
+
+	err("OK");
+}
+
 int main(void)
 {
 	test_single();
 	test_dirty();
 	test_allow_dup();
 	test_ignore_dup();
+	test_stack();
 
 	return 0;
 }
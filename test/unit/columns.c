@@ -0,0 +1,189 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "emu/columns.h"
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "emu/bay.h"
+#include "emu/chan.h"
+#include "emu/pv/prv.h"
+#include "unittest.h"
+#include "value.h"
+
+#define NROWS 4
+#define NSTEPS 100000
+
+static char *
+load(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		die("fopen failed:");
+
+	fseek(f, 0, SEEK_END);
+	*size = (size_t) ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	char *buf = malloc(*size);
+	if (buf == NULL)
+		die("malloc failed:");
+
+	if (fread(buf, *size, 1, f) != 1)
+		die("fread failed:");
+
+	fclose(f);
+	return buf;
+}
+
+static uint64_t
+get_varint(const char **p)
+{
+	uint64_t v = 0;
+	for (int shift = 0; ; shift += 7) {
+		uint8_t b = (uint8_t) *(*p)++;
+		v |= (uint64_t) (b & 0x7f) << shift;
+		if ((b & 0x80) == 0)
+			return v;
+	}
+}
+
+/* Decodes all the values of the series in the arrays */
+static int64_t
+read_series(const char *buf, int64_t row, int64_t type,
+		int64_t *times, int64_t *values)
+{
+	struct columns_header hdr;
+	memcpy(&hdr, buf, sizeof(hdr));
+	if (memcmp(hdr.magic, COLUMNS_MAGIC, sizeof(hdr.magic)) != 0)
+		die("bad magic");
+	if (hdr.version != COLUMNS_VERSION)
+		die("bad version");
+
+	const struct columns_series *series = (const void *) (buf + hdr.index);
+	const struct columns_chunk *chunks = (const void *) (series + hdr.nseries);
+
+	for (int64_t i = 0; i < hdr.nseries; i++) {
+		const struct columns_series *s = &series[i];
+		if (s->row != row || s->type != type)
+			continue;
+
+		int64_t n = 0;
+		for (int64_t j = 0; j < s->nchunks; j++) {
+			const struct columns_chunk *c = &chunks[s->first_chunk + j];
+			if (c->series != i)
+				die("chunk of series %" PRIi64 " in series %" PRIi64,
+						c->series, i);
+
+			const char *pt = buf + c->offset;
+			const char *pv = pt + c->tsize;
+			int64_t t = 0, v = 0;
+			for (int64_t k = 0; k < c->nvalues; k++) {
+				t += (int64_t) get_varint(&pt);
+				uint64_t zz = get_varint(&pv);
+				v += (int64_t) (zz >> 1) ^ -(int64_t) (zz & 1);
+				if (k == 0 && t != c->first_time)
+					die("bad first time");
+				times[n] = t;
+				values[n] = v;
+				n++;
+			}
+
+			if (pt != buf + c->offset + c->tsize
+					|| pv != buf + c->offset + c->tsize + c->vsize)
+				die("bad chunk size");
+		}
+
+		if (n != s->nvalues)
+			die("series has %" PRIi64 " values, read %" PRIi64,
+					s->nvalues, n);
+
+		return n;
+	}
+
+	die("missing series row=%" PRIi64 " type=%" PRIi64, row, type);
+	return -1;
+}
+
+static void
+test_series(void)
+{
+	const char *path = "test.col";
+	struct columns cols;
+	OK(columns_open(&cols, NROWS, path));
+
+	struct bay bay;
+	bay_init(&bay);
+
+	/* One channel changes on every step, with large and negative
+	 * values, the other with duplicates */
+	struct chan a, b;
+	chan_init(&a, CHAN_SINGLE, "a");
+	chan_init(&b, CHAN_SINGLE, "b");
+	chan_prop_set(&b, CHAN_ALLOW_DUP, 1);
+	OK(bay_register(&bay, &a));
+	OK(bay_register(&bay, &b));
+	OK(columns_register(&cols, 1, 10, &bay, &a, 0));
+	OK(columns_register(&cols, 3, 20, &bay, &b, PRV_SKIPDUP | PRV_NEXT));
+	ERR(columns_register(&cols, NROWS, 20, &bay, &b, 0));
+
+	for (int64_t i = 0; i < NSTEPS; i++) {
+		OK(columns_advance(&cols, 1000 + i * 37));
+		int64_t v = (i % 2 ? -1 : 1) * i * 1000000007LL;
+		OK(chan_set(&a, value_int64(v)));
+		OK(chan_set(&b, value_int64(i / 10)));
+		OK(bay_propagate(&bay));
+	}
+
+	OK(columns_close(&cols));
+
+	size_t size;
+	char *buf = load(path, &size);
+
+	int64_t *times = calloc(NSTEPS, sizeof(int64_t));
+	int64_t *values = calloc(NSTEPS, sizeof(int64_t));
+	if (times == NULL || values == NULL)
+		die("calloc failed:");
+
+	int64_t n = read_series(buf, 1, 10, times, values);
+	if (n != NSTEPS)
+		die("expected %d values, found %" PRIi64, NSTEPS, n);
+
+	for (int64_t i = 0; i < n; i++) {
+		int64_t v = (i % 2 ? -1 : 1) * i * 1000000007LL;
+		if (times[i] != 1000 + i * 37 || values[i] != v)
+			die("bad value %" PRIi64 " at %" PRIi64, values[i], i);
+	}
+
+	/* Only the changes, plus one */
+	n = read_series(buf, 3, 20, times, values);
+	if (n != NSTEPS / 10)
+		die("expected %d values, found %" PRIi64, NSTEPS / 10, n);
+
+	for (int64_t i = 0; i < n; i++) {
+		if (times[i] != 1000 + i * 10 * 37 || values[i] != i + 1)
+			die("bad value %" PRIi64 " at %" PRIi64, values[i], i);
+	}
+
+	/* Several chunks were written */
+	struct columns_header hdr;
+	memcpy(&hdr, buf, sizeof(hdr));
+	if (hdr.nchunks < 3)
+		die("expected more chunks, found %" PRIi64, hdr.nchunks);
+
+	free(times);
+	free(values);
+	free(buf);
+
+	err("OK");
+}
+
+int main(void)
+{
+	test_series();
+
+	return 0;
+}
@@ -144,6 +144,64 @@ test_duplicate_output(struct mux *mux, int key1, int key2)
 	err("OK");
 }
 
+/* Two muxes with the same input channels must both follow the input they
+ * select, and stop following it once they select another one */
+static void
+test_shared_input(void)
+{
+	struct bay bay;
+	bay_init(&bay);
+
+	struct chan inputs[2];
+	struct chan output[2];
+	struct chan select[2];
+	struct mux mux[2];
+
+	for (int i = 0; i < 2; i++) {
+		chan_init(&inputs[i], CHAN_SINGLE, "shared.input.%d", i);
+		chan_init(&output[i], CHAN_SINGLE, "shared.output.%d", i);
+		chan_init(&select[i], CHAN_SINGLE, "shared.select.%d", i);
+		OK(bay_register(&bay, &inputs[i]));
+		OK(bay_register(&bay, &output[i]));
+		OK(bay_register(&bay, &select[i]));
+	}
+
+	for (int m = 0; m < 2; m++) {
+		OK(mux_init(&mux[m], &bay, &select[m], &output[m], NULL, 2));
+		for (int i = 0; i < 2; i++)
+			OK(mux_set_input(&mux[m], i, &inputs[i]));
+	}
+
+	OK(chan_set(&inputs[0], value_int64(100)));
+	OK(chan_set(&inputs[1], value_int64(200)));
+
+	/* Both select the input 0 */
+	OK(chan_set(&select[0], value_int64(0)));
+	OK(chan_set(&select[1], value_int64(0)));
+	OK(bay_propagate(&bay));
+	check_output(&mux[0], value_int64(100));
+	check_output(&mux[1], value_int64(100));
+
+	OK(chan_set(&inputs[0], value_int64(101)));
+	OK(bay_propagate(&bay));
+	check_output(&mux[0], value_int64(101));
+	check_output(&mux[1], value_int64(101));
+
+	/* The second mux moves to the input 1 */
+	OK(chan_set(&select[1], value_int64(1)));
+	OK(bay_propagate(&bay));
+	check_output(&mux[0], value_int64(101));
+	check_output(&mux[1], value_int64(200));
+
+	OK(chan_set(&inputs[0], value_int64(102)));
+	OK(chan_set(&inputs[1], value_int64(201)));
+	OK(bay_propagate(&bay));
+	check_output(&mux[0], value_int64(102));
+	check_output(&mux[1], value_int64(201));
+
+	err("OK");
+}
+
 int
 main(void)
 {
@@ -188,6 +246,7 @@ main(void)
 	test_input_and_select(&mux, 4);
 	test_mid_propagate(&mux, 5);
 	test_duplicate_output(&mux, 6, 7);
+	test_shared_input();
 
 	err("OK");
 
@@ -0,0 +1,257 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "emu/perfetto.h"
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "emu/bay.h"
+#include "emu/chan.h"
+#include "emu/pv/pcf.h"
+#include "emu/pv/prf.h"
+#include "emu/pv/prv.h"
+#include "unittest.h"
+#include "value.h"
+
+#define NROWS 3
+#define TYPE 100
+
+/* One decoded packet with a track descriptor or a track event */
+struct packet {
+	uint64_t time;
+	uint64_t uuid;
+	uint64_t parent;
+	uint64_t type; /* Of the track event, or zero */
+	uint64_t iid;
+	char name[256];
+};
+
+static uint64_t
+get_varint(const uint8_t **p)
+{
+	uint64_t v = 0;
+	for (int shift = 0; ; shift += 7) {
+		uint8_t b = *(*p)++;
+		v |= (uint64_t) (b & 0x7f) << shift;
+		if ((b & 0x80) == 0)
+			return v;
+	}
+}
+
+/* Calls fn for each field of the message in p, with the payload of the
+ * length-delimited fields in data and n */
+static void
+each_field(const uint8_t *p, size_t size,
+		void (*fn)(int field, uint64_t v, const uint8_t *data, void *arg),
+		void *arg)
+{
+	const uint8_t *end = p + size;
+	while (p < end) {
+		uint64_t tag = get_varint(&p);
+		int field = (int) (tag >> 3);
+		if ((tag & 7) == 0) {
+			fn(field, get_varint(&p), NULL, arg);
+		} else if ((tag & 7) == 2) {
+			uint64_t n = get_varint(&p);
+			fn(field, n, p, arg);
+			p += n;
+		} else {
+			die("unexpected wire type %d", (int) (tag & 7));
+		}
+	}
+}
+
+/* Names interned in the sequence, by iid */
+static char names[64][256];
+
+static void
+on_event_name(int field, uint64_t v, const uint8_t *data, void *arg)
+{
+	uint64_t *iid = arg;
+	if (field == 1)
+		*iid = v;
+	else if (field == 2)
+		sprintf(names[*iid], "%.*s", (int) v, (const char *) data);
+}
+
+static void
+on_interned(int field, uint64_t v, const uint8_t *data, void *arg)
+{
+	UNUSED(arg);
+	uint64_t iid = 0;
+	if (field == 2)
+		each_field(data, v, on_event_name, &iid);
+}
+
+static void
+on_track_event(int field, uint64_t v, const uint8_t *data, void *arg)
+{
+	UNUSED(data);
+	struct packet *pk = arg;
+	if (field == 9)
+		pk->type = v;
+	else if (field == 10)
+		pk->iid = v;
+	else if (field == 11)
+		pk->uuid = v;
+}
+
+static void
+on_descriptor(int field, uint64_t v, const uint8_t *data, void *arg)
+{
+	struct packet *pk = arg;
+	if (field == 1)
+		pk->uuid = v;
+	else if (field == 5)
+		pk->parent = v;
+	else if (field == 2)
+		sprintf(pk->name, "%.*s", (int) v, (const char *) data);
+}
+
+static void
+on_packet(int field, uint64_t v, const uint8_t *data, void *arg)
+{
+	struct packet *pk = arg;
+	if (field == 8)
+		pk->time = v;
+	else if (field == 11)
+		each_field(data, v, on_track_event, pk);
+	else if (field == 12)
+		each_field(data, v, on_interned, NULL);
+	else if (field == 60)
+		each_field(data, v, on_descriptor, pk);
+}
+
+struct trace {
+	struct packet pk[256];
+	int n;
+};
+
+static void
+on_trace(int field, uint64_t v, const uint8_t *data, void *arg)
+{
+	struct trace *tr = arg;
+	if (field != 1)
+		die("unexpected field %d in trace", field);
+
+	struct packet *pk = &tr->pk[tr->n++];
+	memset(pk, 0, sizeof(*pk));
+	each_field(data, v, on_packet, pk);
+
+	/* Resolve the interned names as they appear */
+	if (pk->iid != 0)
+		sprintf(pk->name, "%s", names[pk->iid]);
+}
+
+static void
+load(const char *path, struct trace *tr)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		die("fopen failed:");
+
+	static uint8_t buf[64 * 1024];
+	size_t n = fread(buf, 1, sizeof(buf), f);
+	fclose(f);
+
+	tr->n = 0;
+	each_field(buf, n, on_trace, tr);
+}
+
+static void
+check_slice(struct trace *tr, int i, uint64_t time, uint64_t type,
+		const char *name)
+{
+	if (i >= tr->n)
+		die("missing packet %d", i);
+
+	struct packet *pk = &tr->pk[i];
+	if (pk->time != time || pk->type != type || strcmp(pk->name, name) != 0) {
+		die("packet %d: got time=%" PRIu64 " type=%" PRIu64 " name='%s', "
+				"expected %" PRIu64 " %" PRIu64 " '%s'",
+				i, pk->time, pk->type, pk->name, time, type, name);
+	}
+}
+
+static void
+test_slices(void)
+{
+	const char *path = "test.pftrace";
+	struct pcf pcf;
+	struct prf prf;
+	OK(pcf_open(&pcf, "test.pcf"));
+	OK(prf_open(&prf, "test.row", NROWS));
+	OK(prf_add(&prf, 1, "THREAD 1.2"));
+
+	struct pcf_type *type = pcf_add_type(&pcf, TYPE, "Subsystem");
+	if (type == NULL)
+		die("pcf_add_type failed");
+	if (pcf_add_value(type, 1, "Running") == NULL)
+		die("pcf_add_value failed");
+
+	struct perfetto pft;
+	OK(perfetto_open(&pft, NROWS, path, &pcf, &prf));
+
+	struct bay bay;
+	bay_init(&bay);
+
+	struct chan chan;
+	chan_init(&chan, CHAN_SINGLE, "testchan");
+	chan_prop_set(&chan, CHAN_ALLOW_DUP, 1);
+	OK(bay_register(&bay, &chan));
+	OK(perfetto_register(&pft, 1, TYPE, &bay, &chan, PRV_SKIPDUP));
+
+	/* Out of bounds */
+	ERR(perfetto_register(&pft, NROWS, TYPE, &bay, &chan, 0));
+
+	int64_t values[] = { 1, 1, 7, 0, 1 };
+	for (int i = 0; i < 5; i++) {
+		OK(perfetto_advance(&pft, 10 * (i + 1)));
+		OK(chan_set(&chan, value_int64(values[i])));
+		OK(bay_propagate(&bay));
+	}
+
+	/* Ends the open slice */
+	OK(perfetto_advance(&pft, 100));
+	OK(perfetto_close(&pft));
+
+	struct trace *tr = calloc(1, sizeof(struct trace));
+	if (tr == NULL)
+		die("calloc failed:");
+	load(path, tr);
+
+	/* Sequence start, then the tracks of the row and the type */
+	if (tr->n < 3)
+		die("missing packets");
+	if (tr->pk[1].uuid != 2 || strcmp(tr->pk[1].name, "THREAD 1.2") != 0)
+		die("bad row track '%s'", tr->pk[1].name);
+	if (tr->pk[2].parent != 2 || strcmp(tr->pk[2].name, "Subsystem") != 0)
+		die("bad type track '%s'", tr->pk[2].name);
+
+	/* The duplicate at 20 is skipped, values without label use the
+	 * number as name */
+	int i = 3;
+	check_slice(tr, i++, 10, 1, "Running");
+	check_slice(tr, i++, 30, 2, "");
+	check_slice(tr, i++, 30, 1, "7");
+	check_slice(tr, i++, 40, 2, "");
+	check_slice(tr, i++, 50, 1, "Running");
+	check_slice(tr, i++, 100, 2, "");
+
+	if (i != tr->n)
+		die("unexpected %d packets", tr->n - i);
+
+	free(tr);
+
+	err("OK");
+}
+
+int main(void)
+{
+	test_slices();
+
+	return 0;
+}
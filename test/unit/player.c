@@ -0,0 +1,185 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include "common.h"
+#include "emu/player.h"
+#include "emu/stream.h"
+#include "emu/trace.h"
+#include "ovni.h"
+#include "unittest.h"
+
+#define NSTREAMS 5
+#define NEVENTS 6
+
+/* Some clocks are repeated among streams to test the tie breaking */
+static const int64_t clocks[NSTREAMS][NEVENTS] = {
+	{  1,  5,  5,  9, 20, 21 },
+	{  2,  5,  6,  7,  8, 30 },
+	{  0,  0,  0,  0,  0,  0 }, /* Empty stream */
+	{  3,  4, 10, 11, 12, 13 },
+	{  5,  5,  5,  5, 40, 41 },
+};
+
+static const int nevents[NSTREAMS] = { 6, 6, 0, 6, 6 };
+
+/* Order of the streams as played by player_step() */
+static int order[NSTREAMS * NEVENTS];
+
+static void
+write_dummy_json(const char *path)
+{
+	const char *json = "{ \"version\" : 3 }";
+	FILE *f = fopen(path, "w");
+
+	if (f == NULL)
+		die("fopen json failed:");
+
+	if (fwrite(json, strlen(json), 1, f) != 1)
+		die("fwrite json failed:");
+
+	fclose(f);
+}
+
+static void
+write_stream(int s)
+{
+	char path[PATH_MAX];
+	sprintf(path, "trace/s%d", s);
+	OK(mkdir(path, 0755));
+
+	sprintf(path, "trace/s%d/stream.json", s);
+	write_dummy_json(path);
+
+	sprintf(path, "trace/s%d/stream.obs", s);
+	FILE *f = fopen(path, "w");
+	if (f == NULL)
+		die("fopen failed:");
+
+	struct ovni_stream_header header;
+	memcpy(&header.magic, OVNI_STREAM_MAGIC, 4);
+	header.version = OVNI_STREAM_VERSION;
+
+	if (fwrite(&header, sizeof(header), 1, f) != 1)
+		die("fwrite failed:");
+
+	for (int i = 0; i < nevents[s]; i++) {
+		struct ovni_ev ev = {0};
+		ovni_ev_set_mcv(&ev, "OU[");
+		ovni_ev_set_clock(&ev, (uint64_t) clocks[s][i]);
+
+		/* Store the stream in the value to check it back */
+		ev.header.value = (uint8_t) ('0' + s);
+
+		if (fwrite(&ev, (size_t) ovni_ev_size(&ev), 1, f) != 1)
+			die("fwrite failed:");
+	}
+
+	fclose(f);
+}
+
+static void
+test_merge(void)
+{
+	OK(mkdir("trace", 0755));
+
+	int total = 0;
+	for (int s = 0; s < NSTREAMS; s++) {
+		write_stream(s);
+		total += nevents[s];
+	}
+
+	struct trace trace;
+	OK(trace_load(&trace, "trace"));
+
+	struct player player;
+	OK(player_init(&player, &trace, 0));
+
+	int64_t lastclock = -1;
+	int lastindex = -1;
+	int n = 0;
+	int ret;
+	while ((ret = player_step(&player)) == 0) {
+		struct emu_ev *ev = player_ev(&player);
+		int s = ev->v - '0';
+
+		if (ev->sclock < lastclock)
+			die("clock goes backwards %"PRIi64" -> %"PRIi64,
+					lastclock, ev->sclock);
+
+		/* Same clock must come in stream order */
+		if (ev->sclock == lastclock && s < lastindex)
+			die("tie at clock %"PRIi64" not ordered by stream",
+					ev->sclock);
+
+		lastclock = ev->sclock;
+		lastindex = s;
+		order[n++] = s;
+	}
+
+	if (ret < 0)
+		die("player_step failed");
+
+	if (n != total)
+		die("expected %d events, got %d", total, n);
+
+	if (player_nprocessed(&player) != total)
+		die("wrong number of processed events");
+
+	/* Must remain finished */
+	if (player_step(&player) <= 0)
+		die("player_step didn't finish");
+
+	err("OK");
+}
+
+static int
+check_order(struct player *player, void *arg)
+{
+	int *n = arg;
+	struct emu_ev *ev = player_ev(player);
+	int s = ev->v - '0';
+
+	if (order[*n] != s)
+		die("event %d comes from stream %d, expected %d",
+				*n, s, order[*n]);
+
+	(*n)++;
+
+	return 0;
+}
+
+/* Must play the same events as player_step() */
+static void
+test_step_n(void)
+{
+	struct trace trace;
+	OK(trace_load(&trace, "trace"));
+
+	struct player player;
+	OK(player_init(&player, &trace, 0));
+
+	int n = 0;
+	int ret;
+	while ((ret = player_step_n(&player, 4, check_order, &n)) == 0)
+		;
+
+	if (ret < 0)
+		die("player_step_n failed");
+
+	if (n != player_nprocessed(&player))
+		die("wrong number of events played");
+
+	err("OK");
+}
+
+int main(void)
+{
+	test_merge();
+	test_step_n();
+
+	return 0;
+}
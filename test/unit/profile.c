@@ -0,0 +1,133 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "emu/profile.h"
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "common.h"
+#include "emu/bay.h"
+#include "emu/chan.h"
+#include "emu/pv/pcf.h"
+#include "emu/pv/prf.h"
+#include "emu/pv/prv.h"
+#include "unittest.h"
+#include "value.h"
+
+#define NROWS 3
+#define TYPE 100
+
+static void
+check_stat(struct profile *prof, long row, int64_t value,
+		int64_t count, int64_t total)
+{
+	struct profile_stat *stat = profile_find(prof, row, TYPE, value);
+	if (stat == NULL)
+		die("missing value %" PRIi64 " of row %ld", value, row);
+
+	if (stat->count != count || stat->total != total)
+		die("value %" PRIi64 ": got count=%" PRIi64 " total=%" PRIi64
+				", expected %" PRIi64 " %" PRIi64,
+				value, stat->count, stat->total, count, total);
+
+	int64_t n = 0;
+	for (int i = 0; i < PROFILE_NBUCKETS; i++)
+		n += profile_hist(stat, i);
+
+	if (n != count)
+		die("histogram of value %" PRIi64 " has %" PRIi64 " entries",
+				value, n);
+}
+
+static void
+test_profile(void)
+{
+	const char *path = "test.prof";
+	struct pcf pcf;
+	struct prf prf;
+	OK(pcf_open(&pcf, "test.pcf"));
+	OK(prf_open(&prf, "test.row", NROWS));
+	OK(prf_add(&prf, 1, "THREAD 1.2"));
+
+	struct pcf_type *type = pcf_add_type(&pcf, TYPE, "Subsystem");
+	if (type == NULL)
+		die("pcf_add_type failed");
+	if (pcf_add_value(type, 1, "Running") == NULL)
+		die("pcf_add_value failed");
+
+	struct profile prof;
+	OK(profile_open(&prof, NROWS, path, &pcf, &prf));
+
+	struct bay bay;
+	bay_init(&bay);
+
+	struct chan chan;
+	chan_init(&chan, CHAN_SINGLE, "testchan");
+	chan_prop_set(&chan, CHAN_ALLOW_DUP, 1);
+	OK(bay_register(&bay, &chan));
+	OK(profile_register(&prof, 1, TYPE, &bay, &chan, PRV_SKIPDUP));
+
+	/* Out of bounds */
+	ERR(profile_register(&prof, NROWS, TYPE, &bay, &chan, 0));
+
+	int64_t times[] = { 10, 20, 30, 40, 50, 1074 };
+	int64_t values[] = { 1, 1, 7, 0, 1, 7 };
+	for (int i = 0; i < 6; i++) {
+		OK(profile_advance(&prof, times[i]));
+		OK(chan_set(&chan, value_int64(values[i])));
+		OK(bay_propagate(&bay));
+	}
+
+	/* The duplicate at 20 continues the value, the zero is not
+	 * accounted */
+	check_stat(&prof, 1, 1, 2, 20 + 1024);
+	check_stat(&prof, 1, 7, 1, 10);
+	if (profile_hist(profile_find(&prof, 1, TYPE, 7), 3) != 1)
+		die("bad histogram of a single duration");
+	if (profile_find(&prof, 1, TYPE, 0) != NULL)
+		die("zero value accounted");
+
+	struct profile_stat *stat = profile_find(&prof, 1, TYPE, 1);
+	if (profile_hist(stat, 4) != 1 || profile_hist(stat, 10) != 1)
+		die("bad histogram");
+
+	/* Ends the open value */
+	OK(profile_advance(&prof, 3122));
+	OK(profile_close(&prof));
+	OK(pcf_close(&pcf));
+
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		die("fopen failed:");
+
+	char line[1024];
+	const char *expected[] = {
+		"2\t100\t1\t2\t1044\t4:1,10:1\tTHREAD 1.2\tSubsystem\tRunning\n",
+		"2\t100\t7\t2\t2058\t3:1,11:1\tTHREAD 1.2\tSubsystem\t\n",
+	};
+
+	if (fgets(line, sizeof(line), f) == NULL || line[0] != '#')
+		die("missing header");
+
+	for (int i = 0; i < 2; i++) {
+		if (fgets(line, sizeof(line), f) == NULL)
+			die("missing line %d", i);
+		if (strcmp(line, expected[i]) != 0)
+			die("line %d: got '%s', expected '%s'", i, line, expected[i]);
+	}
+
+	if (fgets(line, sizeof(line), f) != NULL)
+		die("unexpected line '%s'", line);
+
+	fclose(f);
+
+	err("OK");
+}
+
+int main(void)
+{
+	test_profile();
+
+	return 0;
+}
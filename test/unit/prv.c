@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 #include "common.h"
 #include "emu/bay.h"
@@ -96,6 +97,71 @@ test_dup(const char *path)
 	err("OK");
 }
 
+static void
+test_format(const char *path)
+{
+	/* Ensure the lines are formatted like printf() does, with numbers
+	 * of all lengths and signs */
+	static const int64_t values[] = {
+		1, 9, 10, 99, 100, 12345, 1000000000, -1, -10, -987654321,
+		INT64_MAX, INT64_MIN, INT64_MAX - 1, INT64_MIN + 1,
+	};
+	int n = (int) (sizeof(values) / sizeof(values[0]));
+	long type = 123456;
+
+	struct bay bay;
+	bay_init(&bay);
+
+	struct prv prv;
+	OK(prv_open(&prv, NROWS, path));
+
+	struct chan chan;
+	chan_init(&chan, CHAN_SINGLE, "testchan");
+	OK(bay_register(&bay, &chan));
+	OK(prv_register(&prv, NROWS - 1, type, &bay, &chan, PRV_ZERO));
+
+	int64_t time = 0;
+	for (int i = 0; i < n; i++) {
+		OK(chan_set(&chan, value_int64(values[i])));
+		time = time * 10 + 7;
+		OK(prv_advance(&prv, time));
+		OK(bay_propagate(&bay));
+	}
+
+	OK(prv_close(&prv));
+
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		die("fopen failed:");
+
+	char line[1024];
+	char expected[1024];
+
+	/* Skip header */
+	if (fgets(line, 1024, f) == NULL)
+		die("missing header");
+
+	time = 0;
+	for (int i = 0; i < n; i++) {
+		time = time * 10 + 7;
+		if (fgets(line, 1024, f) == NULL)
+			die("missing line %d", i);
+
+		sprintf(expected, "2:0:1:1:%d:%" PRIi64 ":%ld:%" PRIi64 "\n",
+				NROWS, time, type, values[i]);
+
+		if (strcmp(line, expected) != 0)
+			die("got line '%s', expected '%s'", line, expected);
+	}
+
+	if (fgets(line, 1024, f) != NULL)
+		die("unexpected line '%s'", line);
+
+	fclose(f);
+
+	err("OK");
+}
+
 static int
 count_prv_lines(char *fpath, int64_t time, int row0, long type, long value)
 {
@@ -168,7 +234,7 @@ test_skipdup(char *fname)
 
 	/* Propagate will emit the value into the PRV */
 	OK(bay_propagate(&bay));
-	fflush(wf);
+	OK(prv_flush(&prv));
 
 	/* Check for the line */
 	if (count_prv_lines(fname, time, 0, type, value) != 1)
@@ -179,7 +245,7 @@ test_skipdup(char *fname)
 
 	/* Propagate again, emitting the value */
 	OK(bay_propagate(&bay));
-	fflush(wf);
+	OK(prv_flush(&prv));
 
 	/* Ensure that we didn't write it again */
 	if (count_prv_lines(fname, time, 0, type, value) != 1)
@@ -225,7 +291,7 @@ test_emitdup(char *fname)
 
 	/* Propagate will emit the value into the PRV */
 	OK(bay_propagate(&bay));
-	fflush(wf);
+	OK(prv_flush(&prv));
 
 	/* Check for the line */
 	if (count_prv_lines(fname, time, 0, type, value) != 1)
@@ -236,7 +302,7 @@ test_emitdup(char *fname)
 
 	/* Propagate again, emitting the value */
 	OK(bay_propagate(&bay));
-	fflush(wf);
+	OK(prv_flush(&prv));
 
 	/* Ensure that we write it again */
 	if (count_prv_lines(fname, time, 0, type, value) != 2)
@@ -273,6 +339,106 @@ test_same_type(const char *path)
 	err("OK");
 }
 
+static void
+check_file(const char *path, const char *expected)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		die("fopen %s failed:", path);
+
+	char buf[1024];
+	size_t n = fread(buf, 1, sizeof(buf) - 1, f);
+	buf[n] = '\0';
+	fclose(f);
+
+	if (strcmp(buf, expected) != 0)
+		die("%s: got:\n%s\nexpected:\n%s", path, buf, expected);
+}
+
+static void
+test_shard(void)
+{
+	struct bay bay;
+	bay_init(&bay);
+
+	/* The state continues in the next shard, the events don't */
+	struct chan state, event;
+	chan_init(&state, CHAN_SINGLE, "state");
+	chan_init(&event, CHAN_SINGLE, "event");
+	chan_prop_set(&event, CHAN_ALLOW_DUP, 1);
+	OK(bay_register(&bay, &state));
+	OK(bay_register(&bay, &event));
+
+	struct prv prv;
+	OK(prv_open(&prv, NROWS, "shard.prv"));
+	OK(prv_register(&prv, 0, 100, &bay, &state, 0));
+	OK(prv_register(&prv, 1, 200, &bay, &event, PRV_EMITDUP));
+
+	/* Shards every 100 ns of trace time */
+	OK(prv_shard(&prv, "shard", 100, 0));
+
+	OK(prv_advance(&prv, 10));
+	OK(chan_set(&state, value_int64(1)));
+	OK(chan_set(&event, value_int64(5)));
+	OK(bay_propagate(&bay));
+
+	OK(prv_advance(&prv, 50));
+	OK(chan_set(&state, value_int64(2)));
+	OK(bay_propagate(&bay));
+
+	OK(prv_advance(&prv, 150));
+	OK(chan_set(&event, value_int64(6)));
+	OK(bay_propagate(&bay));
+
+	/* Skips the empty shards */
+	OK(prv_advance(&prv, 420));
+	OK(prv_advance(&prv, 430));
+	OK(prv_close(&prv));
+
+	if (prv.nshards != 3)
+		die("expected 3 shards, found %ld", prv.nshards);
+
+	check_file("shard.0.prv",
+			"#Paraver (19/01/38 at 03:14):00000000000000000150_ns:0:1:1(10:1)\n"
+			"2:0:1:1:1:10:100:1\n"
+			"2:0:1:1:2:10:200:5\n"
+			"2:0:1:1:1:50:100:2\n");
+	check_file("shard.1.prv",
+			"#Paraver (19/01/38 at 03:14):00000000000000000420_ns:0:1:1(10:1)\n"
+			"2:0:1:1:1:150:100:2\n"
+			"2:0:1:1:2:150:200:6\n");
+	check_file("shard.2.prv",
+			"#Paraver (19/01/38 at 03:14):00000000000000000430_ns:0:1:1(10:1)\n"
+			"2:0:1:1:1:420:100:2\n");
+
+	/* Shards of one byte keep the lines of the same time together */
+	bay_init(&bay);
+	struct chan other;
+	chan_init(&other, CHAN_SINGLE, "other");
+	OK(bay_register(&bay, &other));
+	OK(prv_open(&prv, NROWS, "shard.prv"));
+	OK(prv_register(&prv, 0, 100, &bay, &other, 0));
+	OK(prv_shard(&prv, "size", 0, 1));
+
+	for (int64_t t = 1; t <= 4; t++) {
+		OK(prv_advance(&prv, t));
+		OK(chan_set(&other, value_int64(t)));
+		OK(bay_propagate(&bay));
+		OK(prv_advance(&prv, t));
+	}
+	OK(prv_close(&prv));
+
+	if (prv.nshards != 4)
+		die("expected 4 shards, found %ld", prv.nshards);
+
+	check_file("size.3.prv",
+			"#Paraver (19/01/38 at 03:14):00000000000000000004_ns:0:1:1(10:1)\n"
+			"2:0:1:1:1:4:100:3\n"
+			"2:0:1:1:1:4:100:4\n");
+
+	err("OK");
+}
+
 int main(void)
 {
 	char fname[] = "ovni.prv";
@@ -282,6 +448,8 @@ int main(void)
 	test_skipdup(fname);
 	test_emitdup(fname);
 	test_same_type(fname);
+	test_format(fname);
+	test_shard();
 
 	return 0;
 }
@@ -0,0 +1,154 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "common.h"
+#include "emu/bay.h"
+#include "emu/chan.h"
+#include "emu/pv/prv.h"
+#include "emu/pv/prv_bin.h"
+#include "unittest.h"
+#include "value.h"
+
+#define NROWS 16
+#define NSTEPS 40000
+
+struct out {
+	struct bay bay;
+	struct prv prv;
+	struct chan chan[NROWS][2];
+};
+
+static void
+out_open(struct out *o, const char *path, int binary)
+{
+	bay_init(&o->bay);
+
+	if (binary)
+		OK(prv_open_bin(&o->prv, NROWS, path));
+	else
+		OK(prv_open(&o->prv, NROWS, path));
+
+	OK(prv_coalesce(&o->prv));
+
+	for (int i = 0; i < NROWS; i++) {
+		for (int j = 0; j < 2; j++) {
+			struct chan *ch = &o->chan[i][j];
+			chan_init(ch, CHAN_SINGLE, "testchan.%d.%d", i, j);
+			OK(bay_register(&o->bay, ch));
+			OK(prv_register(&o->prv, i, 100 + j, &o->bay, ch, PRV_ZERO));
+		}
+	}
+}
+
+static void
+out_step(struct out *o, int64_t step)
+{
+	for (int i = 0; i < NROWS; i++) {
+		/* Large and negative values, the second event only some times */
+		int64_t v = (step * 1000003LL + i) * (step % 3 == 0 ? -1 : 1);
+		OK(chan_set(&o->chan[i][0], value_int64(v * 100000)));
+		if ((step + i) % 2 == 0)
+			OK(chan_set(&o->chan[i][1], value_int64(step)));
+	}
+
+	/* Some steps happen at the same time */
+	OK(prv_advance(&o->prv, step / 2 * 3));
+	OK(bay_propagate(&o->bay));
+	OK(prv_commit(&o->prv));
+}
+
+static char *
+load(const char *path, size_t *size)
+{
+	FILE *f = fopen(path, "r");
+	if (f == NULL)
+		die("fopen failed:");
+
+	fseek(f, 0, SEEK_END);
+	*size = (size_t) ftell(f);
+	fseek(f, 0, SEEK_SET);
+
+	char *buf = malloc(*size + 1);
+	if (buf == NULL)
+		die("malloc failed:");
+
+	if (*size > 0 && fread(buf, *size, 1, f) != 1)
+		die("fread failed:");
+
+	fclose(f);
+	return buf;
+}
+
+static void
+test_convert(int nthreads)
+{
+	/* The binary log spans several blocks, which must be converted to the
+	 * same lines written in the PRV file */
+	struct out *text = calloc(1, sizeof(struct out));
+	struct out *bin = calloc(1, sizeof(struct out));
+	if (text == NULL || bin == NULL)
+		die("calloc failed:");
+
+	out_open(text, "text.prv", 0);
+	out_open(bin, "ovni.bprv", 1);
+
+	for (int64_t step = 1; step <= NSTEPS; step++) {
+		out_step(text, step);
+		out_step(bin, step);
+	}
+
+	OK(prv_close(&text->prv));
+	OK(prv_close(&bin->prv));
+
+	size_t binsize;
+	free(load("ovni.bprv", &binsize));
+	if (binsize < 2 * PRV_BUFSIZE)
+		die("binary log too small: %zu bytes", binsize);
+
+	OK(prv_bin_convert("ovni.bprv", "ovni.prv", nthreads));
+
+	size_t n1, n2;
+	char *a = load("text.prv", &n1);
+	char *b = load("ovni.prv", &n2);
+
+	if (n1 != n2)
+		die("size mismatch: %zu and %zu bytes", n1, n2);
+
+	if (memcmp(a, b, n1) != 0)
+		die("converted PRV differs");
+
+	free(a);
+	free(b);
+	free(text);
+	free(bin);
+
+	err("OK");
+}
+
+static void
+test_bad(void)
+{
+	FILE *f = fopen("bad.bprv", "w");
+	if (f == NULL)
+		die("fopen failed:");
+	fprintf(f, "not a binary log");
+	fclose(f);
+
+	ERR(prv_bin_convert("bad.bprv", "bad.prv", 1));
+	ERR(prv_bin_convert("missing.bprv", "bad.prv", 1));
+
+	err("OK");
+}
+
+int main(void)
+{
+	test_convert(1);
+	test_convert(3);
+	test_bad();
+
+	return 0;
+}
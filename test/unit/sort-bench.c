@@ -0,0 +1,112 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "emu/sort.h"
+#include <stdlib.h>
+#include <time.h>
+#include "bay.h"
+#include "chan.h"
+#include "common.h"
+#include "unittest.h"
+#include "value.h"
+
+static void
+check_output(struct chan *chan, struct value expected)
+{
+	struct value out_value = value_null();
+	if (chan_read(chan, &out_value) != 0)
+		die("chan_read() failed for channel %s", chan->name);
+
+	if (!value_is_equal(&out_value, &expected)) {
+		die("unexpected value found %s in output (expected %s)\n",
+				value_str(out_value),
+				value_str(expected));
+	}
+}
+
+static double
+get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double) ts.tv_sec + (double) ts.tv_nsec * 1.0e-9;
+}
+
+static int
+cmp_int64(const void *a, const void *b)
+{
+	int64_t aa = *(const int64_t *) a;
+	int64_t bb = *(const int64_t *) b;
+
+	return (aa > bb) - (aa < bb);
+}
+
+/* Changes one random input at a time among a few values, like the
+ * breakdown sorts over all the CPUs do, and measures the time of each
+ * propagation, to see how it grows with the number of inputs. The
+ * outputs are checked at the end. */
+static void
+bench_sort(int64_t n, long nchanges)
+{
+	struct bay bay;
+	bay_init(&bay);
+
+	struct chan *inputs = calloc((size_t) n, sizeof(struct chan));
+	int64_t *values = calloc((size_t) n, sizeof(int64_t));
+	if (inputs == NULL || values == NULL)
+		die("calloc failed:");
+
+	for (int64_t i = 0; i < n; i++) {
+		chan_init(&inputs[i], CHAN_SINGLE, "bench.input.%"PRIi64, i);
+		OK(bay_register(&bay, &inputs[i]));
+	}
+
+	struct sort sort;
+	OK(sort_init(&sort, &bay, n, "bench.sort"));
+
+	for (int64_t i = 0; i < n; i++)
+		OK(sort_set_input(&sort, i, &inputs[i]));
+
+	srand(1);
+	for (int64_t i = 0; i < n; i++) {
+		values[i] = rand() % 8;
+		OK(chan_set(&inputs[i], value_int64(values[i])));
+	}
+	OK(bay_propagate(&bay));
+
+	double t0 = get_time();
+	for (long k = 0; k < nchanges; k++) {
+		int64_t i = rand() % n;
+		int64_t v = (values[i] + 1 + rand() % 7) % 8;
+		values[i] = v;
+		OK(chan_set(&inputs[i], value_int64(v)));
+		OK(bay_propagate(&bay));
+	}
+	double t1 = get_time();
+
+	err("n=%-5"PRIi64" %.1f ns/change", n,
+			(t1 - t0) * 1e9 / (double) nchanges);
+
+	qsort(values, (size_t) n, sizeof(int64_t), cmp_int64);
+	for (int64_t i = 0; i < n; i++)
+		check_output(sort_get_output(&sort, i), value_int64(values[i]));
+
+	free(values);
+}
+
+static void
+test_scaling(void)
+{
+	for (int64_t n = 16; n <= 4096; n *= 4)
+		bench_sort(n, 20000);
+}
+
+int
+main(void)
+{
+	test_scaling();
+
+	err("OK\n");
+
+	return 0;
+}
@@ -0,0 +1,122 @@
+/* Copyright (c) 2025 Barcelona Supercomputing Center (BSC)
+ * SPDX-License-Identifier: GPL-3.0-or-later */
+
+#include "emu/spsc.h"
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include "common.h"
+#include "unittest.h"
+
+#define N (1000 * 1000)
+
+static void
+test_bad_size(void)
+{
+	struct spsc q;
+	ERR(spsc_init(&q, sizeof(int64_t), 0));
+	ERR(spsc_init(&q, sizeof(int64_t), 3));
+
+	err("OK");
+}
+
+static void
+test_full(void)
+{
+	struct spsc q;
+	OK(spsc_init(&q, sizeof(int64_t), 4));
+
+	if (spsc_front(&q) != NULL)
+		die("new queue is not empty");
+
+	for (int64_t i = 0; i < 4; i++) {
+		int64_t *slot = spsc_claim(&q);
+		if (slot == NULL)
+			die("queue full after %ld elements", (long) i);
+		*slot = i;
+		spsc_push(&q);
+	}
+
+	if (spsc_claim(&q) != NULL)
+		die("claimed a slot in a full queue");
+
+	/* Free one slot and wrap around */
+	int64_t *front = spsc_front(&q);
+	if (front == NULL || *front != 0)
+		die("unexpected front");
+	spsc_pop(&q);
+
+	int64_t *slot = spsc_claim(&q);
+	if (slot == NULL)
+		die("cannot claim freed slot");
+	*slot = 4;
+	spsc_push(&q);
+
+	for (int64_t i = 1; i <= 4; i++) {
+		front = spsc_front(&q);
+		if (front == NULL || *front != i)
+			die("unexpected element at %ld", (long) i);
+		spsc_pop(&q);
+	}
+
+	if (spsc_front(&q) != NULL)
+		die("queue not empty at the end");
+
+	spsc_free(&q);
+	err("OK");
+}
+
+static void *
+produce(void *arg)
+{
+	struct spsc *q = arg;
+
+	for (int64_t i = 0; i < N; i++) {
+		int64_t *slot;
+		while ((slot = spsc_claim(q)) == NULL)
+			sched_yield();
+		*slot = i;
+		spsc_push(q);
+	}
+
+	return NULL;
+}
+
+/* The consumer must see all the elements in order */
+static void
+test_threads(void)
+{
+	struct spsc q;
+	OK(spsc_init(&q, sizeof(int64_t), 64));
+
+	pthread_t th;
+	OK(pthread_create(&th, NULL, produce, &q));
+
+	for (int64_t i = 0; i < N; i++) {
+		int64_t *front;
+		while ((front = spsc_front(&q)) == NULL)
+			sched_yield();
+
+		if (*front != i)
+			die("expected %ld, found %ld", (long) i, (long) *front);
+		spsc_pop(&q);
+	}
+
+	OK(pthread_join(th, NULL));
+
+	if (spsc_front(&q) != NULL)
+		die("queue not empty at the end");
+
+	spsc_free(&q);
+	err("OK");
+}
+
+int
+main(void)
+{
+	test_bad_size();
+	test_full();
+	test_threads();
+
+	return 0;
+}
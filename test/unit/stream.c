@@ -87,10 +87,98 @@ test_bad(void)
 	err("OK");
 }
 
+/* Reading through a window must give the same events as when the stream
+ * is mapped, even for jumbo events larger than the window */
+static void
+test_window(void)
+{
+	OK(mkdir("win", 0755));
+
+	FILE *f = fopen("win/stream.obs", "w");
+	if (f == NULL)
+		die("fopen failed:");
+
+	struct ovni_stream_header header;
+	memcpy(&header.magic, OVNI_STREAM_MAGIC, 4);
+	header.version = OVNI_STREAM_VERSION;
+
+	if (fwrite(&header, sizeof(header), 1, f) != 1)
+		die("fwrite failed:");
+
+	int nevents = 20000;
+	uint32_t jumbosize = 3 * STREAM_MIN_WINDOW;
+	uint8_t *jumbo = calloc(1, jumbosize);
+	if (jumbo == NULL)
+		die("calloc failed:");
+
+	for (int i = 0; i < nevents; i++) {
+		struct ovni_ev ev = {0};
+		ovni_ev_set_mcv(&ev, "OU[");
+		ovni_ev_set_clock(&ev, (uint64_t) i);
+
+		if (i == nevents / 2) {
+			ev.header.flags = OVNI_EV_JUMBO;
+			jumbo[0] = jumbo[jumbosize - 1] = (uint8_t) i;
+			if (fwrite(&ev.header, sizeof(ev.header), 1, f) != 1)
+				die("fwrite failed:");
+			if (fwrite(&jumbosize, sizeof(jumbosize), 1, f) != 1)
+				die("fwrite failed:");
+			if (fwrite(jumbo, jumbosize, 1, f) != 1)
+				die("fwrite failed:");
+			continue;
+		}
+
+		/* Vary the size to cross the window in the middle */
+		uint8_t payload[16] = {0};
+		payload[0] = (uint8_t) i;
+		ovni_payload_add(&ev, payload, 2 + i % 15);
+
+		if (fwrite(&ev, (size_t) ovni_ev_size(&ev), 1, f) != 1)
+			die("fwrite failed:");
+	}
+
+	fclose(f);
+	free(jumbo);
+
+	write_dummy_json("win/stream.json");
+
+	struct stream mapped, window;
+	OK(stream_load(&mapped, ".", "win"));
+	OK(stream_load_window(&window, ".", "win", STREAM_MIN_WINDOW));
+
+	for (int i = 0; i < nevents; i++) {
+		OK(stream_step(&mapped));
+		OK(stream_step(&window));
+
+		struct ovni_ev *a = stream_ev(&mapped);
+		struct ovni_ev *b = stream_ev(&window);
+		int size = ovni_ev_size(a);
+		if (size != ovni_ev_size(b))
+			die("event %d has different size", i);
+		if (memcmp(a, b, (size_t) size) != 0)
+			die("event %d differs", i);
+		if (stream_lastclock(&window) != i)
+			die("event %d has wrong clock", i);
+	}
+
+	if (stream_step(&mapped) != 1 || stream_step(&window) != 1)
+		die("streams didn't end");
+
+	/* The buffer must be back to the window size after the jumbo event */
+	if (window.bufsize != STREAM_MIN_WINDOW)
+		die("window buffer not shrunk");
+
+	/* The window cannot be below the minimum */
+	ERR(stream_load_window(&window, ".", "win", STREAM_MIN_WINDOW - 1));
+
+	err("OK");
+}
+
 int main(void)
 {
 	test_ok();
 	test_bad();
+	test_window();
 
 	return 0;
 }